@@ -0,0 +1,28 @@
+#version 330 core
+
+in vec2 TexCoords;
+in vec3 Color;
+in vec2 Resolution;
+// Position within the quad, TexCoords may point into an atlas
+in vec2 LocalCoords;
+
+out vec4 color;
+
+uniform sampler2D image;
+
+vec4 circle(vec2 uv)
+{
+    vec4 col = vec4(1);
+    float d = length(uv);
+    col.a = smoothstep(0.5, 0.49, d);
+    return col;
+}
+
+void main()
+{
+	vec2 uv = LocalCoords;
+    uv -= 0.5;
+    uv.x *= Resolution.x / Resolution.y; 
+
+  color = circle(uv) * vec4(Color, 1.0) * texture(image, TexCoords);
+}
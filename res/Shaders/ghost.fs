@@ -11,10 +11,16 @@ uniform vec2 u_resolution;
 uniform float u_radius;
 uniform vec3 u_color;
 uniform sampler2D image;
-uniform vec2 u_screenResolution;
 uniform vec2 u_mousePos;
 uniform float u_time;
 
+layout (std140) uniform Camera
+{
+	mat4 u_view;
+	mat4 u_projection;
+	vec2 u_screenResolution;
+};
+
 float remap01(float a, float b, float t) {
 	return sat((t-a)/(b-a));
 }
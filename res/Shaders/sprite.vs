@@ -4,9 +4,15 @@ layout (location = 0) in vec4 vertex;
 
 out vec2 TexCoords;
 
-uniform mat4 u_model; 
-uniform mat4 u_view;
-uniform mat4 u_projection;
+// Filled once per frame by CameraBuffer
+layout (std140) uniform Camera
+{
+	mat4 u_view;
+	mat4 u_projection;
+	vec2 u_screenResolution;
+};
+
+uniform mat4 u_model;
 
 void main()
 {	
@@ -0,0 +1,30 @@
+#version 330 core
+
+layout (location = 0) in vec2 a_position;
+layout (location = 1) in vec2 a_texCoords;
+layout (location = 2) in vec3 a_color;
+layout (location = 3) in vec2 a_size;
+layout (location = 4) in vec2 a_corner;
+
+out vec2 TexCoords;
+out vec3 Color;
+out vec2 Resolution;
+out vec2 LocalCoords;
+
+// Filled once per frame by CameraBuffer
+layout (std140) uniform Camera
+{
+	mat4 u_view;
+	mat4 u_projection;
+	vec2 u_screenResolution;
+};
+
+void main()
+{	
+	TexCoords = a_texCoords;
+	Color = a_color;
+	Resolution = a_size;
+	LocalCoords = a_corner;
+	// Positions arrive in view space, the batcher composes the view on the CPU
+	gl_Position = u_projection * vec4(a_position, 0.0, 1.0);
+}
@@ -0,0 +1,34 @@
+#version 330 core
+
+layout (location = 0) in vec2 vertex;
+layout (location = 1) in vec3 i_row0;
+layout (location = 2) in vec3 i_row1;
+layout (location = 3) in vec2 i_size;
+layout (location = 4) in vec3 i_color;
+layout (location = 5) in vec4 i_uv;
+
+out vec2 TexCoords;
+out vec3 Color;
+out vec2 Resolution;
+out vec2 LocalCoords;
+
+// Filled once per frame by CameraBuffer
+layout (std140) uniform Camera
+{
+	mat4 u_view;
+	mat4 u_projection;
+	vec2 u_screenResolution;
+};
+
+void main()
+{	
+	// Instance rows are view * model with origin and size folded in
+	vec3 corner = vec3(vertex, 1.0);
+	vec2 position = vec2(dot(i_row0, corner), dot(i_row1, corner));
+
+	TexCoords = mix(i_uv.xy, i_uv.zw, vertex);
+	LocalCoords = vertex;
+	Color = i_color;
+	Resolution = i_size;
+	gl_Position = u_projection * vec4(position, 0.0, 1.0);
+}
@@ -9,7 +9,13 @@ uniform vec2 u_resolution;
 uniform vec3 u_color;
 uniform sampler2D image;
 uniform float u_time;
-uniform vec2 u_screenResolution;
+
+layout (std140) uniform Camera
+{
+	mat4 u_view;
+	mat4 u_projection;
+	vec2 u_screenResolution;
+};
 
 
 vec4 circle(vec2 uv)
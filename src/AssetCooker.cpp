@@ -0,0 +1,92 @@
+#include "AssetCooker.h"
+#include "AssetPack.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+#include "stb_image.h"
+
+namespace
+{
+	// Regular files in directory, sorted so packs come out the same on every machine
+	std::vector<std::string> list_files(const std::string& directory)
+	{
+		std::vector<std::string> files;
+#ifdef _WIN32
+		WIN32_FIND_DATAA data;
+		HANDLE find = FindFirstFileA((directory + "/*").c_str(), &data);
+		if (find != INVALID_HANDLE_VALUE)
+		{
+			do
+			{
+				if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+					files.push_back(directory + "/" + data.cFileName);
+			} while (FindNextFileA(find, &data));
+			FindClose(find);
+		}
+#else
+		if (DIR* dir = opendir(directory.c_str()))
+		{
+			while (dirent* entry = readdir(dir))
+				if (entry->d_name[0] != '.')
+					files.push_back(directory + "/" + entry->d_name);
+			closedir(dir);
+		}
+#endif
+		std::sort(files.begin(), files.end());
+		return files;
+	}
+}
+
+namespace AssetCooker
+{
+	int run(const std::string& pack_file)
+	{
+		auto start = std::chrono::steady_clock::now();
+		AssetPackWriter writer;
+		bool ok = true;
+
+		for (const std::string& file : list_files("res/Images"))
+		{
+			int width, height, channels;
+			unsigned char* pixels = stbi_load(file.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+			if (!pixels)
+			{
+				std::cerr << "Failed to load texture: " << file << std::endl;
+				ok = false;
+				continue;
+			}
+			writer.add_image(file, width, height, pixels);
+			stbi_image_free(pixels);
+			std::cout << file << " " << width << "x" << height << std::endl;
+		}
+
+		for (const std::string& file : list_files("res/Shaders"))
+		{
+			std::ifstream in(file, std::ios::binary);
+			std::stringstream text;
+			text << in.rdbuf();
+			writer.add_text(file, text.str());
+			std::cout << file << std::endl;
+		}
+
+		if (!ok || !writer.write(pack_file))
+			return 1;
+
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		std::cout << "cooked " << writer.entry_count() << " assets into " << pack_file << " in " << elapsed.count() << " ms" << std::endl;
+		return 0;
+	}
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+
+// Offline step, run with `TinyEngine --cook [pack]`. Decodes every image in res/Images and
+// reads every shader in res/Shaders into one AssetPack, so startup maps one file instead of
+// decoding images and building mipmaps.
+namespace AssetCooker
+{
+	constexpr const char* default_pack = "res/assets.pack";
+
+	int run(const std::string& pack_file);
+}
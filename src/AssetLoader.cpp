@@ -0,0 +1,191 @@
+#include "AssetLoader.h"
+#include "gl_state.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "stb_image.h"
+
+namespace
+{
+	// Shown until the real image is in, white keeps tinted materials their color
+	const unsigned char placeholder_rgba[4] = { 255, 255, 255, 255 };
+}
+
+AssetLoader::AssetLoader(unsigned decode_threads, std::size_t upload_budget, const AssetPack* pack)
+	: pack_(pack), upload_budget_(upload_budget)
+{
+	glGenBuffers(pbo_count, pbos_);
+
+	for (unsigned i = 0; i < std::max(decode_threads, 1u); ++i)
+		threads_.emplace_back(&AssetLoader::decode_loop, this);
+}
+
+AssetLoader::~AssetLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		running_ = false;
+	}
+	wake_.notify_all();
+	for (auto& thread : threads_)
+		thread.join();
+
+	glDeleteBuffers(pbo_count, pbos_);
+}
+
+Texture* AssetLoader::load_texture(const std::string& file_name)
+{
+	textures_.push_back(std::make_unique<Texture>());
+	Texture* texture = textures_.back().get();
+	texture->load_placeholder(placeholder_rgba);
+
+	auto request = std::make_unique<Request>();
+	request->texture = texture;
+	request->file_name = file_name;
+
+	// Cooked, ready to upload
+	const PackEntry* entry = pack_ ? pack_->find(file_name, PackEntry::image_rgba8) : nullptr;
+	if (entry)
+	{
+		request->source = pack_->data(*entry);
+		request->width = entry->width;
+		request->height = entry->height;
+		request->mip_count = entry->mip_count;
+		std::lock_guard<std::mutex> lock(mutex_);
+		decoded_.push_back(std::move(request));
+		++in_flight_;
+		return texture;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		to_decode_.push_back(std::move(request));
+		++in_flight_;
+	}
+	wake_.notify_one();
+	return texture;
+}
+
+void AssetLoader::decode_loop()
+{
+	for (;;)
+	{
+		std::unique_ptr<Request> request;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			wake_.wait(lock, [this] { return !running_ || !to_decode_.empty(); });
+			if (!running_)
+				return;
+			request = std::move(to_decode_.front());
+			to_decode_.pop_front();
+		}
+
+		int channels = 0;
+		unsigned char* image = stbi_load(request->file_name.c_str(), &request->width, &request->height, &channels, STBI_rgb_alpha);
+		if (image)
+		{
+			request->pixels.assign(image, image + static_cast<std::size_t>(request->width) * request->height * 4);
+			request->source = request->pixels.data();
+			stbi_image_free(image);
+		}
+		else
+		{
+			std::cout << "Failed to load texture: " << request->file_name << std::endl;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		decoded_.push_back(std::move(request));
+	}
+}
+
+bool AssetLoader::upload(Request& request, std::size_t& budget)
+{
+	if (request.level == 0 && request.next_row == 0)
+		request.texture->allocate(request.width, request.height, request.mip_count);
+
+	const GLuint width = Texture::level_size(request.width, request.level);
+	const GLuint height = Texture::level_size(request.height, request.level);
+	const std::size_t row_bytes = static_cast<std::size_t>(width) * 4;
+
+	// At least one row per call, so rows wider than the budget still make progress
+	const GLuint rows_left = height - request.next_row;
+	const GLuint rows = static_cast<GLuint>(std::min<std::size_t>(rows_left, std::max<std::size_t>(budget / row_bytes, 1)));
+	const std::size_t bytes = rows * row_bytes;
+	const unsigned char* pixels = request.source + request.next_row * row_bytes;
+
+	// Orphan the next buffer in the ring, the driver keeps the old storage alive for pending copies
+	GLState::bind_buffer(GL_PIXEL_UNPACK_BUFFER, pbos_[next_pbo_]);
+	next_pbo_ = (next_pbo_ + 1) % pbo_count;
+	GLState::buffer_data(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+	void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	if (mapped)
+	{
+		std::memcpy(mapped, pixels, bytes);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		request.texture->upload_rows(request.next_row, rows, nullptr, request.level);
+	}
+	GLState::bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	if (!mapped)
+		request.texture->upload_rows(request.next_row, rows, pixels, request.level);
+
+	GLState::counters().buffer_bytes += bytes;
+	last_frame_bytes_ += bytes;
+
+	request.next_row += rows;
+	budget -= std::min(budget, bytes);
+	if (request.next_row < height)
+		return false;
+
+	// Next level starts right after this one
+	request.source += height * row_bytes;
+	request.next_row = 0;
+	if (++request.level < request.mip_count)
+		return false;
+
+	request.texture->finish_upload();
+	return true;
+}
+
+void AssetLoader::update()
+{
+	PROFILE_ZONE("AssetLoader::update");
+	std::size_t budget = upload_budget_;
+	last_frame_bytes_ = 0;
+	while (budget > 0)
+	{
+		if (!uploading_)
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (decoded_.empty())
+				break;
+			uploading_ = std::move(decoded_.front());
+			decoded_.pop_front();
+		}
+
+		// Failed decodes keep the placeholder
+		if (!uploading_->source || upload(*uploading_, budget))
+		{
+			uploading_.reset();
+			std::lock_guard<std::mutex> lock(mutex_);
+			--in_flight_;
+		}
+	}
+}
+
+void AssetLoader::finish()
+{
+	while (pending() > 0)
+	{
+		update();
+		std::this_thread::yield();
+	}
+}
+
+std::size_t AssetLoader::pending() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return in_flight_;
+}
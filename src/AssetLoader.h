@@ -0,0 +1,85 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <glad/glad.h>
+
+#include "AssetPack.h"
+#include "texture.h"
+
+// Streams textures in without blocking the render thread. load_texture() hands back a texture
+// showing a 1x1 placeholder right away; decode threads run stb_image, and update() copies the
+// decoded rows into a ring of pixel unpack buffers and on into the texture, at most
+// upload_budget bytes per frame, so a large image arrives over several frames instead of as a hitch.
+//
+// Textures found in the asset pack skip decoding altogether, their cooked mip chain streams
+// straight out of the mapping.
+//
+// Decoding gets its own threads rather than JobSystem jobs: a decode takes milliseconds and a
+// frame's parallel_for would otherwise pick one up on the main thread while it waits.
+class AssetLoader
+{
+public:
+	static constexpr unsigned pbo_count = 3;
+
+	// pack, when given, has to outlive the loader
+	AssetLoader(unsigned decode_threads = 1, std::size_t upload_budget = 4 << 20, const AssetPack* pack = nullptr);
+	~AssetLoader();
+
+	AssetLoader(const AssetLoader&) = delete;
+	AssetLoader& operator=(const AssetLoader&) = delete;
+
+	// The loader owns the texture. Files that fail to decode keep the placeholder.
+	Texture* load_texture(const std::string& file_name);
+
+	// Call once per frame on the GL thread
+	void update();
+
+	// Runs update() until every queued texture is in, for loading screens and tools
+	void finish();
+
+	std::size_t pending() const;
+	std::size_t bytes_uploaded_last_frame() const { return last_frame_bytes_; }
+
+private:
+	struct Request
+	{
+		Texture* texture;
+		std::string file_name;
+		// Decoded RGBA8, empty on failure and for packed textures
+		std::vector<unsigned char> pixels;
+		// Level after level of RGBA8, into pixels or the pack. nullptr on failure.
+		const unsigned char* source = nullptr;
+		int width = 0, height = 0;
+		GLuint mip_count = 1;
+		GLuint level = 0, next_row = 0;
+	};
+
+	void decode_loop();
+	bool upload(Request& request, std::size_t& budget);
+
+	std::vector<std::unique_ptr<Texture>> textures_;
+	const AssetPack* pack_;
+
+	// Shared with the decode threads
+	mutable std::mutex mutex_;
+	std::condition_variable wake_;
+	std::deque<std::unique_ptr<Request>> to_decode_;
+	std::deque<std::unique_ptr<Request>> decoded_;
+	std::size_t in_flight_ = 0;
+	bool running_ = true;
+	std::vector<std::thread> threads_;
+
+	// GL thread only
+	std::unique_ptr<Request> uploading_;
+	GLuint pbos_[pbo_count];
+	unsigned next_pbo_ = 0;
+	std::size_t upload_budget_;
+	std::size_t last_frame_bytes_ = 0;
+};
@@ -0,0 +1,223 @@
+#include "AssetPack.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sys/stat.h>
+
+namespace
+{
+	constexpr std::size_t data_alignment = 64;
+	// Offsets are from the start of the file, the header takes the first aligned block
+	constexpr std::size_t data_start = data_alignment;
+	static_assert(sizeof(PackHeader) <= data_start, "PackHeader has to fit before the data");
+
+	std::size_t align(std::size_t offset)
+	{
+		return (offset + data_alignment - 1) / data_alignment * data_alignment;
+	}
+	const char pack_magic[4] = { 'T', 'E', 'P', 'K' };
+
+	// Seconds since the epoch, 0 when the file is missing
+	std::int64_t modified_time(const char* file_name)
+	{
+		struct stat info;
+		return stat(file_name, &info) == 0 ? static_cast<std::int64_t>(info.st_mtime) : 0;
+	}
+
+	std::size_t mip_bytes(std::uint32_t width, std::uint32_t height)
+	{
+		return static_cast<std::size_t>(width) * height * 4;
+	}
+
+	std::uint32_t next_mip(std::uint32_t size)
+	{
+		return std::max(size / 2, 1u);
+	}
+
+	// What the runtime reads out of an entry has to be there: every level of an image, and
+	// the NUL that ends a text
+	bool valid_contents(const PackEntry& entry, const unsigned char* data)
+	{
+		if (entry.type == PackEntry::text)
+			return entry.size > 0 && data[entry.size - 1] == '\0';
+		if (entry.type != PackEntry::image_rgba8)
+			return true;
+
+		// 32 levels take any 32 bit size down to 1x1
+		if (entry.width == 0 || entry.height == 0 || entry.mip_count == 0 || entry.mip_count > 32)
+			return false;
+		std::uint64_t bytes = 0;
+		std::uint32_t width = entry.width, height = entry.height;
+		for (std::uint32_t level = 0; level < entry.mip_count; ++level)
+		{
+			bytes += static_cast<std::uint64_t>(width) * height * 4;
+			width = next_mip(width);
+			height = next_mip(height);
+		}
+		return bytes <= entry.size;
+	}
+}
+
+AssetPack::~AssetPack()
+{
+	close();
+}
+
+bool AssetPack::open(const std::string& file_name)
+{
+	close();
+	if (!file_.open(file_name))
+		return false;
+	base_ = file_.data();
+	size_ = file_.size();
+
+	// Header, then every entry has to lie inside the file and hold what its type promises
+	const PackHeader* header = reinterpret_cast<const PackHeader*>(base_);
+	bool valid = size_ >= sizeof(PackHeader) && std::memcmp(header->magic, pack_magic, 4) == 0 && header->version == version
+		&& header->toc_offset <= size_ && header->toc_offset % alignof(PackEntry) == 0
+		&& (size_ - header->toc_offset) / sizeof(PackEntry) >= header->entry_count;
+	for (std::uint32_t i = 0; valid && i < header->entry_count; ++i)
+	{
+		const PackEntry* entry = reinterpret_cast<const PackEntry*>(base_ + header->toc_offset) + i;
+		valid = entry->offset <= size_ && entry->offset % data_alignment == 0 && entry->size <= size_ - entry->offset
+			&& entry->name[sizeof(entry->name) - 1] == '\0'
+			&& valid_contents(*entry, base_ + entry->offset);
+		entries_.push_back(entry);
+	}
+
+	if (!valid)
+	{
+		std::cerr << "Invalid asset pack: " << file_name << std::endl;
+		close();
+		return false;
+	}
+	modified_ = modified_time(file_name.c_str());
+	return true;
+}
+
+void AssetPack::close()
+{
+	file_.close();
+	base_ = nullptr;
+	size_ = 0;
+	modified_ = 0;
+	entries_.clear();
+}
+
+const PackEntry* AssetPack::stale_entry() const
+{
+	for (const PackEntry* entry : entries_)
+		if (modified_time(entry->name) > modified_)
+			return entry;
+	return nullptr;
+}
+
+const PackEntry* AssetPack::find(const std::string& name, PackEntry::Type type) const
+{
+	for (const PackEntry* entry : entries_)
+		if (entry->type == type && name == entry->name)
+			return entry;
+	return nullptr;
+}
+
+const unsigned char* AssetPack::mip(const PackEntry& entry, std::uint32_t level, std::uint32_t& width, std::uint32_t& height) const
+{
+	const unsigned char* pixels = data(entry);
+	width = entry.width;
+	height = entry.height;
+	for (std::uint32_t i = 0; i < level; ++i)
+	{
+		pixels += mip_bytes(width, height);
+		width = next_mip(width);
+		height = next_mip(height);
+	}
+	return pixels;
+}
+
+void AssetPackWriter::add_entry(PackEntry entry, const unsigned char* data, std::size_t size)
+{
+	data_.resize(align(data_.size()));
+	entry.offset = data_start + data_.size();
+	entry.size = size;
+	data_.insert(data_.end(), data, data + size);
+	entries_.push_back(entry);
+}
+
+void AssetPackWriter::add_image(const std::string& name, std::uint32_t width, std::uint32_t height, const unsigned char* pixels)
+{
+	PackEntry entry = {};
+	std::strncpy(entry.name, name.c_str(), sizeof(entry.name) - 1);
+	entry.type = PackEntry::image_rgba8;
+	entry.width = width;
+	entry.height = height;
+
+	// Level 0, then halve until 1x1, clamping at the edge for odd sizes
+	std::vector<unsigned char> chain(pixels, pixels + mip_bytes(width, height));
+	std::size_t level_offset = 0;
+	entry.mip_count = 1;
+	while (width > 1 || height > 1)
+	{
+		const std::uint32_t next_width = next_mip(width), next_height = next_mip(height);
+		const std::size_t next_offset = chain.size();
+		chain.resize(next_offset + mip_bytes(next_width, next_height));
+
+		for (std::uint32_t y = 0; y < next_height; ++y)
+		{
+			for (std::uint32_t x = 0; x < next_width; ++x)
+			{
+				const std::uint32_t x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+				const std::uint32_t y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+				const unsigned char* level = chain.data() + level_offset;
+				for (int channel = 0; channel < 4; ++channel)
+				{
+					const unsigned sum = level[(y0 * width + x0) * 4 + channel] + level[(y0 * width + x1) * 4 + channel]
+						+ level[(y1 * width + x0) * 4 + channel] + level[(y1 * width + x1) * 4 + channel];
+					chain[next_offset + (y * next_width + x) * 4 + channel] = static_cast<unsigned char>((sum + 2) / 4);
+				}
+			}
+		}
+
+		level_offset = next_offset;
+		width = next_width;
+		height = next_height;
+		++entry.mip_count;
+	}
+
+	add_entry(entry, chain.data(), chain.size());
+}
+
+void AssetPackWriter::add_text(const std::string& name, const std::string& text)
+{
+	PackEntry entry = {};
+	std::strncpy(entry.name, name.c_str(), sizeof(entry.name) - 1);
+	entry.type = PackEntry::text;
+
+	// Size includes the terminator so the mapping can go straight to glShaderSource
+	add_entry(entry, reinterpret_cast<const unsigned char*>(text.c_str()), text.size() + 1);
+}
+
+bool AssetPackWriter::write(const std::string& file_name) const
+{
+	std::ofstream out(file_name, std::ios::binary);
+	if (!out)
+	{
+		std::cerr << "Failed to open asset pack for writing: " << file_name << std::endl;
+		return false;
+	}
+
+	PackHeader header = {};
+	std::memcpy(header.magic, pack_magic, 4);
+	header.version = AssetPack::version;
+	header.entry_count = static_cast<std::uint32_t>(entries_.size());
+	header.toc_offset = data_start + align(data_.size());
+
+	const char padding[data_alignment] = {};
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.write(padding, data_start - sizeof(header));
+	out.write(reinterpret_cast<const char*>(data_.data()), data_.size());
+	out.write(padding, align(data_.size()) - data_.size());
+	out.write(reinterpret_cast<const char*>(entries_.data()), entries_.size() * sizeof(PackEntry));
+	return static_cast<bool>(out);
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+// Binary asset pack written by the cooker (TinyEngine --cook) and memory mapped at runtime.
+//
+//   PackHeader padded to 64 bytes | entry data, each at a 64 byte aligned offset | PackEntry
+//   table of contents, also 64 byte aligned
+//
+// Images are decoded RGBA8 with their full mip chain stored level after level, so the
+// runtime uploads straight out of the mapping. Text (shader sources) is NUL terminated
+// and handed to GL as is. All fields are little endian.
+struct PackHeader
+{
+	char magic[4];
+	std::uint32_t version;
+	std::uint32_t entry_count;
+	std::uint32_t reserved;
+	std::uint64_t toc_offset;
+};
+
+struct PackEntry
+{
+	enum Type : std::uint32_t
+	{
+		image_rgba8 = 1,
+		text = 2,
+	};
+
+	// Path the asset was cooked from, e.g. "res/Images/white.png"
+	char name[96];
+	std::uint32_t type;
+	std::uint32_t width, height, mip_count;
+	std::uint64_t offset, size;
+};
+
+static_assert(sizeof(PackHeader) == 24, "PackHeader layout is part of the file format");
+static_assert(sizeof(PackEntry) == 128, "PackEntry layout is part of the file format");
+
+// Read only view of a pack file. Pointers it returns stay valid until close().
+class AssetPack
+{
+public:
+	// 2 padded the header so data offsets are aligned in the file
+	static constexpr std::uint32_t version = 2;
+
+	AssetPack() = default;
+	~AssetPack();
+
+	AssetPack(const AssetPack&) = delete;
+	AssetPack& operator=(const AssetPack&) = delete;
+
+	// Maps the file and checks the header and table of contents
+	bool open(const std::string& file_name);
+	void close();
+	bool is_open() const { return base_ != nullptr; }
+
+	// First entry whose source file was saved after the pack was, nullptr when the pack is
+	// up to date. Sources that are gone do not count.
+	const PackEntry* stale_entry() const;
+
+	// nullptr when there is no entry of that name and type
+	const PackEntry* find(const std::string& name, PackEntry::Type type) const;
+	const std::vector<const PackEntry*>& entries() const { return entries_; }
+
+	const unsigned char* data(const PackEntry& entry) const { return base_ + entry.offset; }
+	const char* text(const PackEntry& entry) const { return reinterpret_cast<const char*>(data(entry)); }
+
+	// Level `level` of an image, with its dimensions
+	const unsigned char* mip(const PackEntry& entry, std::uint32_t level, std::uint32_t& width, std::uint32_t& height) const;
+
+private:
+	MappedFile file_;
+	const unsigned char* base_ = nullptr;
+	std::size_t size_ = 0;
+	std::int64_t modified_ = 0;
+	std::vector<const PackEntry*> entries_;
+};
+
+// Builds a pack in memory, the cooker's side
+class AssetPackWriter
+{
+public:
+	// pixels are RGBA8, the mip chain is built here with a 2x2 box filter
+	void add_image(const std::string& name, std::uint32_t width, std::uint32_t height, const unsigned char* pixels);
+	void add_text(const std::string& name, const std::string& text);
+
+	bool write(const std::string& file_name) const;
+
+	std::size_t entry_count() const { return entries_.size(); }
+
+private:
+	void add_entry(PackEntry entry, const unsigned char* data, std::size_t size);
+
+	std::vector<PackEntry> entries_;
+	std::vector<unsigned char> data_;
+};
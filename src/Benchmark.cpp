@@ -0,0 +1,813 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+#include "Crowd.h"
+#include "EntityStore.h"
+#include "FABRIKSolver.h"
+#include "IKSolver.h"
+#include "IKSolverBatch.h"
+#include "JobSystem.h"
+#include "Terrain.h"
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	// Best of `repeats` runs, in seconds
+	template <typename Fn>
+	double best_time(int repeats, Fn&& fn)
+	{
+		double best = 1e30;
+		for (int i = 0; i < repeats; ++i)
+		{
+			auto start = Clock::now();
+			fn();
+			std::chrono::duration<double> elapsed = Clock::now() - start;
+			best = std::min(best, elapsed.count());
+		}
+		return best;
+	}
+
+	// 1, 2, 4, ... below the core count, then the core count itself
+	std::vector<unsigned> thread_counts()
+	{
+		const unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+		std::vector<unsigned> counts;
+		for (unsigned threads = 1; threads < max_threads; threads *= 2)
+			counts.push_back(threads);
+		counts.push_back(max_threads);
+		return counts;
+	}
+
+	// Random legs spread around the reachable, unreachable and folded cases
+	void fill_legs(IKSolverBatch& batch, std::size_t count)
+	{
+		std::mt19937 rng(1337);
+		std::uniform_real_distribution<GLfloat> position(-500.0f, 500.0f);
+		std::uniform_real_distribution<GLfloat> length(50.0f, 250.0f);
+
+		batch.resize(count);
+		for (std::size_t i = 0; i < count; ++i)
+			batch.set_leg(i, length(rng), length(rng), { position(rng), position(rng) }, { position(rng), position(rng) }, rng() & 1);
+	}
+
+	void ik_batch(std::size_t count)
+	{
+		if (count == 0) count = 10000;
+		const int repeats = 50;
+
+		IKSolverBatch batch;
+		fill_legs(batch, count);
+
+		std::vector<IKSolver> scalar(count);
+		double scalar_time = best_time(repeats, [&]
+		{
+			for (std::size_t i = 0; i < count; ++i)
+				scalar[i].solve(batch.l1[i], batch.l2[i], { batch.base_x[i], batch.base_y[i] },
+				                { batch.target_x[i], batch.target_y[i] }, batch.flip_direction[i] != 0);
+		});
+
+		double batch_time = best_time(repeats, [&] { batch.solve(); });
+
+		// Deviation from the scalar solver
+		GLfloat max_angle = 0.0f, max_position = 0.0f;
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			max_angle = std::max({ max_angle, std::abs(scalar[i].angle1 - batch.angle1[i]), std::abs(scalar[i].angle2 - batch.angle2[i]) });
+			GLfloat reach = batch.l1[i] + batch.l2[i];
+			max_position = std::max({ max_position, glm::distance(scalar[i].second, batch.second(i)) / reach,
+			                          glm::distance(scalar[i].last, batch.last(i)) / reach });
+		}
+
+		std::cout << "ik_batch: " << count << " legs, kernel " << IKSolverBatch::kernel_name() << "\n"
+			<< "  IKSolver::solve      " << count / scalar_time << " legs/s\n"
+			<< "  IKSolverBatch::solve " << count / batch_time << " legs/s (" << scalar_time / batch_time << "x)\n"
+			<< "  max angle error " << max_angle << " rad, max position error " << max_position << " * (l1 + l2)"
+			<< " (tolerance " << IKSolverBatch::angle_tolerance << ")\n";
+	}
+
+	// Cost per chain of FABRIKSolver against the analytic IKSolver::solve path
+	void fabrik(std::size_t count)
+	{
+		if (count == 0) count = 10000;
+		const int repeats = 20;
+		const GLfloat segment = 100.0f;
+
+		std::mt19937 rng(1337);
+		std::uniform_real_distribution<GLfloat> angle(0.0f, glm::two_pi<GLfloat>());
+		std::uniform_real_distribution<GLfloat> radius(0.2f, 1.0f);
+
+		// Targets inside each chain's reach, the base stays at the origin
+		std::vector<glm::vec2> directions(count);
+		for (auto& d : directions)
+		{
+			GLfloat a = angle(rng);
+			d = glm::vec2(std::cos(a), std::sin(a)) * radius(rng);
+		}
+
+		IKSolver two_bone;
+		double analytic = best_time(repeats, [&]
+		{
+			for (const auto& d : directions)
+				two_bone.solve(segment, segment, { 0, 0 }, d * segment * 2.0f, false);
+		});
+		std::cout << "fabrik: " << count << " chains\n"
+			<< "  IKSolver::solve      2 segments " << analytic / count * 1e9 << " ns/chain\n";
+
+		for (std::size_t segments = 2; segments <= 6; ++segments)
+		{
+			FABRIKSolver chain;
+			chain.set_chain({ 0, 0 }, std::vector<GLfloat>(segments, segment));
+			for (std::size_t j = 1; j < segments; ++j)
+				chain.set_limit(j, -2.5f, 2.5f);
+
+			std::size_t iterations = 0, reached = 0;
+			double time = best_time(repeats, [&]
+			{
+				iterations = reached = 0;
+				for (const auto& d : directions)
+				{
+					reached += chain.solve({ 0, 0 }, d * segment * static_cast<GLfloat>(segments));
+					iterations += chain.iterations;
+				}
+			});
+
+			std::cout << "  FABRIKSolver::solve  " << segments << " segments " << time / count * 1e9 << " ns/chain ("
+				<< time / analytic << "x), " << static_cast<double>(iterations) / count << " iterations avg, "
+				<< 100.0 * reached / count << "% reached\n";
+		}
+	}
+
+	// Leg solves spread over 1..N threads
+	void jobs(std::size_t count)
+	{
+		if (count == 0) count = 20000;
+		const int repeats = 20;
+
+		IKSolverBatch legs;
+		fill_legs(legs, count);
+		std::vector<IKSolver> solvers(count);
+
+		double single = 0.0;
+		std::cout << "jobs: " << count << " IKSolver::solve per frame\n";
+		for (unsigned threads : thread_counts())
+		{
+			JobSystem system(threads);
+			double time = best_time(repeats, [&]
+			{
+				system.parallel_for(count, 256, [&](std::size_t begin, std::size_t end)
+				{
+					for (std::size_t i = begin; i < end; ++i)
+						solvers[i].solve(legs.l1[i], legs.l2[i], { legs.base_x[i], legs.base_y[i] },
+						                 { legs.target_x[i], legs.target_y[i] }, legs.flip_direction[i] != 0);
+				});
+			});
+			if (threads == 1) single = time;
+
+			std::cout << "  " << threads << " threads " << time * 1e3 << " ms/frame, " << count / time << " legs/s ("
+				<< single / time << "x)\n";
+		}
+	}
+
+	// Replica of the old GameObject, one heap allocation each and a virtual update
+	struct LegacyObject
+	{
+		glm::vec2 position = { 0,0 };
+		GLfloat rotation = 0.0f;
+		GLfloat scale = 1.0f;
+		Drawable drawable{};
+
+		virtual ~LegacyObject() = default;
+		virtual void update(GLfloat /*dt*/)
+		{
+			drawable.position = position;
+			drawable.rotation = rotation;
+		}
+	};
+
+	struct LegacySpinner : LegacyObject
+	{
+		void update(GLfloat dt) override
+		{
+			rotation += dt;
+			LegacyObject::update(dt);
+		}
+	};
+
+	// Spin every object and copy its transform into the drawable, old layout against EntityStore
+	void entities(std::size_t count)
+	{
+		if (count == 0) count = 100000;
+		const int repeats = 20;
+		const GLfloat dt = 1.0f / 60.0f;
+
+		std::vector<std::shared_ptr<LegacyObject>> legacy;
+		legacy.reserve(count);
+		for (std::size_t i = 0; i < count; ++i)
+			legacy.push_back(std::make_shared<LegacySpinner>());
+
+		auto update_legacy = [&]
+		{
+			for (auto& object : legacy)
+				object->update(dt);
+		};
+		double legacy_ordered = best_time(repeats, update_legacy);
+
+		// Objects created and destroyed over time end up scattered over the heap
+		std::shuffle(legacy.begin(), legacy.end(), std::mt19937(1337));
+		double legacy_shuffled = best_time(repeats, update_legacy);
+
+		EntityStore store;
+		store.reserve(count);
+		for (std::size_t i = 0; i < count; ++i)
+			store.create();
+
+		// The same spin and copy as LegacySpinner, straight over the dense arrays
+		double dense = best_time(repeats, [&]
+		{
+			auto& positions = store.positions();
+			auto& rotations = store.rotations();
+			auto& drawables = store.drawables();
+			for (std::size_t i = 0; i < rotations.size(); ++i)
+			{
+				rotations[i] += dt;
+				drawables[i].position = positions[i];
+				drawables[i].rotation = rotations[i];
+			}
+		});
+
+		// What the engine does on top every tick: world transforms for everything that
+		// changed, then blended into the drawables
+		double propagate = best_time(repeats, [&]
+		{
+			store.mark_all_dirty();
+			store.update_world_transforms();
+			store.sync_drawables(0, store.size());
+		});
+
+		std::cout << "entities: " << count << " entities, " << sizeof(LegacyObject) << " bytes per GameObject, "
+			<< store.memory_bytes() / count << " bytes per entity\n"
+			<< "  shared_ptr<GameObject>, allocation order " << legacy_ordered * 1e3 << " ms/frame\n"
+			<< "  shared_ptr<GameObject>, shuffled         " << legacy_shuffled * 1e3 << " ms/frame\n"
+			<< "  EntityStore systems                      " << dense * 1e3 << " ms/frame ("
+			<< legacy_ordered / dense << "x, " << legacy_shuffled / dense << "x shuffled)\n"
+			<< "  EntityStore world transforms and sync    " << propagate * 1e3 << " ms/frame, all dirty\n";
+	}
+
+	// World transform propagation through a forest of 8 deep chains, everything dirty against a few roots moved
+	void hierarchy(std::size_t count)
+	{
+		if (count == 0) count = 100000;
+		const int repeats = 20;
+		const std::size_t depth = 8;
+
+		// Created leaf first so the first update has to sort
+		EntityStore store;
+		store.reserve(count);
+		std::vector<Entity> roots;
+		Entity child;
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const Entity entity = store.create();
+			store.transform(entity).position = { 10.0f, 0.0f };
+			store.transform(entity).rotation = 0.1f;
+			if (i % depth != 0)
+				store.set_parent(child, entity);
+			if (i % depth == depth - 1)
+				roots.push_back(entity);
+			child = entity;
+		}
+
+		const auto start = Clock::now();
+		store.update_world_transforms();
+		const std::chrono::duration<double> sort_time = Clock::now() - start;
+
+		double full = best_time(repeats, [&]
+		{
+			store.mark_all_dirty();
+			store.update_world_transforms();
+		});
+
+		// One percent of the chains move
+		std::size_t updated = 0;
+		double partial = best_time(repeats, [&]
+		{
+			for (std::size_t i = 0; i < roots.size(); i += 100)
+				store.transform(roots[i]).rotation += 0.01f;
+			updated = store.update_world_transforms();
+		});
+
+		std::cout << "hierarchy: " << count << " entities in chains of " << depth << "\n"
+			<< "  first update with depth sort " << sort_time.count() * 1e3 << " ms\n"
+			<< "  everything dirty             " << full * 1e3 << " ms\n"
+			<< "  1% of roots moved            " << partial * 1e3 << " ms, " << updated << " recomputed ("
+			<< full / partial << "x)\n";
+	}
+
+	// Props scattered over a large level, visible set through the grid against testing every drawable
+	void culling(std::size_t count)
+	{
+		if (count == 0) count = 50000;
+		const int repeats = 20;
+
+		std::mt19937 rng(1337);
+		std::uniform_real_distribution<GLfloat> position(-20000.0f, 20000.0f);
+		std::uniform_real_distribution<GLfloat> size(16.0f, 256.0f);
+
+		EntityStore store;
+		store.reserve(count);
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const Entity entity = store.create();
+			store.transform(entity).position = { position(rng), position(rng) };
+			store.drawable(entity).size = { size(rng), size(rng) };
+		}
+		store.update_world_transforms();
+		store.sync_drawables(0, store.size());
+
+		Camera camera;
+		const Bounds view = camera.visible_bounds();
+
+		std::size_t brute_visible = 0;
+		double brute = best_time(repeats, [&]
+		{
+			brute_visible = 0;
+			for (const auto& drawable : store.drawables())
+			{
+				const GLfloat radius = 0.5f * glm::length(drawable.size);
+				const glm::vec2 center = drawable.get_affine().apply(glm::vec2(0.5f));
+				if (Bounds{ center - radius, center + radius }.overlaps(view))
+					++brute_visible;
+			}
+		});
+
+		std::vector<std::uint32_t> visible;
+		double grid = best_time(repeats, [&]
+		{
+			store.query_visible(view, visible);
+		});
+
+		// Moving every prop a little, most stay in their cell
+		double moves = best_time(repeats, [&]
+		{
+			for (auto& p : store.positions())
+				p.x += 1.0f;
+			store.mark_all_dirty();
+			store.update_world_transforms();
+		});
+
+		std::cout << "culling: " << count << " drawables, " << store.spatial_grid().cell_count() << " grid cells, "
+			<< visible.size() << " visible (" << brute_visible << " by brute force)\n"
+			<< "  test every drawable  " << brute * 1e3 << " ms\n"
+			<< "  grid query           " << grid * 1e3 << " ms (" << brute / grid << "x)\n"
+			<< "  move all and reindex " << moves * 1e3 << " ms\n";
+	}
+
+	// The model * view chain Drawable and Camera used to build with glm::mat4
+	glm::mat4 glm_model_view(const Drawable& drawable, const glm::mat4& view)
+	{
+		glm::mat4 model = glm::mat4(1);
+		model = glm::translate(model, glm::vec3(drawable.position, 0.0f));
+		model = glm::rotate(model, drawable.rotation, glm::vec3(0.0f, 0.0f, 1.0f));
+		model = glm::translate(model, glm::vec3(-drawable.origin_fraction() * drawable.size, 0.0f));
+		model = glm::scale(model, glm::vec3(drawable.size, 1.0f));
+		return view * model;
+	}
+
+	// Sprite corner transforms through glm::mat4 chains against Affine2
+	void affine(std::size_t count)
+	{
+		if (count == 0) count = 100000;
+		const int repeats = 20;
+
+		std::mt19937 rng(1337);
+		std::uniform_real_distribution<GLfloat> position(-500.0f, 500.0f);
+		std::uniform_real_distribution<GLfloat> angle(-3.2f, 3.2f);
+		std::uniform_real_distribution<GLfloat> size(1.0f, 200.0f);
+
+		std::vector<Drawable> drawables(count);
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			drawables[i].position = { position(rng), position(rng) };
+			drawables[i].rotation = angle(rng);
+			drawables[i].size = { size(rng), size(rng) };
+			drawables[i].transform_origin = static_cast<enum Drawable::transform_origin>(i % 3);
+		}
+
+		Camera camera;
+		camera.position = { 30.0f, -20.0f };
+		camera.zoom = 1.5f;
+		const glm::mat4 view_mat4 = camera.transform_view();
+		const Affine2 view = camera.view_affine();
+
+		// Four corners per sprite, like the batcher
+		std::vector<glm::vec2> glm_corners(count * 4), affine_corners(count * 4);
+		const glm::vec2 corners[] = { { 0, 0 }, { 1, 0 }, { 0, 1 }, { 1, 1 } };
+
+		double glm_time = best_time(repeats, [&]
+		{
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				const glm::mat4 model_view = glm_model_view(drawables[i], view_mat4);
+				for (int corner = 0; corner < 4; ++corner)
+					glm_corners[i * 4 + corner] = glm::vec2(model_view * glm::vec4(corners[corner], 0.0f, 1.0f));
+			}
+		});
+
+		double affine_time = best_time(repeats, [&]
+		{
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				const Affine2 model_view = view * drawables[i].get_affine();
+				for (int corner = 0; corner < 4; ++corner)
+					affine_corners[i * 4 + corner] = model_view.apply(corners[corner]);
+			}
+		});
+
+		GLfloat max_error = 0.0f;
+		for (std::size_t i = 0; i < glm_corners.size(); ++i)
+			max_error = std::max(max_error, glm::distance(glm_corners[i], affine_corners[i]));
+
+		std::cout << "affine: " << count << " sprites\n"
+			<< "  glm::mat4 chain " << glm_time / count * 1e9 << " ns/sprite\n"
+			<< "  Affine2::trs    " << affine_time / count * 1e9 << " ns/sprite (" << glm_time / affine_time << "x)\n"
+			<< "  max corner difference " << max_error << " px\n";
+	}
+
+	// Walkers pacing on scripted periods, drawn through the same entity hierarchy as Prototype.
+	// Stage times per frame for 1..N threads, also written to crowd_benchmark.json.
+	void crowd(std::size_t count)
+	{
+		if (count == 0) count = 10000;
+		const int frames = 300;
+		const GLfloat dt = 1.0f / 60.0f;
+		const GLfloat length = 200.0f;
+		const WalkerDesc desc = WalkerDesc::make(2, length, 0.0f, Gait::tripod);
+
+		struct Visuals
+		{
+			Entity body, head, eye1, eye2;
+			std::vector<Entity> upper, knee;
+		};
+
+		struct Result
+		{
+			unsigned threads;
+			CrowdTimings stages;
+			double visuals, transforms, total;
+		};
+		std::vector<Result> results;
+		std::size_t crowd_bytes = 0, entities_per_walker = 0, entity_bytes = 0;
+
+		std::cout << "crowd: " << count << " walkers, " << desc.legs.size() << " legs each, " << frames << " frames\n";
+		for (unsigned threads : thread_counts())
+		{
+			JobSystem system(threads);
+			Crowd walkers(desc);
+			EntityStore store;
+			std::vector<Visuals> visuals(count);
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				const GLfloat row = static_cast<GLfloat>(i / 100) * length * 3;
+				walkers.add({ (static_cast<GLfloat>(i % 100) - 50.0f) * length * 1.5f, 20 + row }, length * 2 + row, true);
+
+				// hip -> upper -> knee -> foot -> lower, as Prototype::attach_leg
+				Visuals& parts = visuals[i];
+				parts.body = store.create();
+				parts.head = store.create();
+				parts.eye1 = store.create();
+				parts.eye2 = store.create();
+				for (const LegDesc& leg : desc.legs)
+				{
+					Entity hip = store.create(), upper = store.create(), knee = store.create(), foot = store.create(), lower = store.create();
+					store.set_parent(hip, parts.body);
+					store.set_parent(upper, hip);
+					store.set_parent(knee, upper);
+					store.set_parent(foot, knee);
+					store.set_parent(lower, foot);
+					store.transform(knee).position = { leg.upper_length, 0 };
+					store.transform(foot).position = { leg.lower_length, 0 };
+					store.transform(lower).rotation = -glm::pi<GLfloat>();
+					parts.upper.push_back(upper);
+					parts.knee.push_back(knee);
+				}
+			}
+			crowd_bytes = walkers.memory_bytes();
+			entities_per_walker = store.size() / count;
+
+			Result result = { threads, {}, 0.0, 0.0, 0.0 };
+			for (int frame = 0; frame < frames; ++frame)
+			{
+				auto start = Clock::now();
+				walkers.update(dt, &system);
+				auto simulated = Clock::now();
+
+				const IKSolverBatch& solved = walkers.rig().solved();
+				for (std::size_t i = 0; i < count; ++i)
+				{
+					const Visuals& parts = visuals[i];
+					store.transform(parts.body).position = walkers.rig().position(i);
+					store.transform(parts.head).position = walkers.head(i);
+					store.transform(parts.eye1).position = walkers.eye1(i);
+					store.transform(parts.eye2).position = walkers.eye2(i);
+					const std::size_t first = walkers.rig().first_leg(i);
+					for (std::size_t leg = 0; leg < parts.upper.size(); ++leg)
+					{
+						store.transform(parts.upper[leg]).rotation = solved.angle1[first + leg];
+						store.transform(parts.knee[leg]).rotation = solved.angle2[first + leg] + glm::pi<GLfloat>();
+					}
+				}
+				auto shown = Clock::now();
+
+				store.update_world_transforms();
+				store.sync_drawables(system);
+				auto end = Clock::now();
+
+				const CrowdTimings& stages = walkers.timings();
+				result.stages.script += stages.script;
+				result.stages.step += stages.step;
+				result.stages.solve += stages.solve;
+				result.stages.face += stages.face;
+				result.visuals += std::chrono::duration<double, std::milli>(shown - simulated).count();
+				result.transforms += std::chrono::duration<double, std::milli>(end - shown).count();
+				result.total += std::chrono::duration<double, std::milli>(end - start).count();
+			}
+			for (double* value : { &result.stages.script, &result.stages.step, &result.stages.solve, &result.stages.face,
+			                       &result.visuals, &result.transforms, &result.total })
+				*value /= frames;
+			results.push_back(result);
+			// After the frames, so the spatial grid holds every entity
+			entity_bytes = store.memory_bytes();
+
+			std::cout << "  " << threads << " threads " << result.total << " ms/frame (" << results[0].total / result.total << "x): script "
+				<< result.stages.script << ", step " << result.stages.step << ", solve " << result.stages.solve << ", face "
+				<< result.stages.face << ", visuals " << result.visuals << ", transforms " << result.transforms << "\n";
+		}
+		std::cout << "  " << crowd_bytes / count << " bytes per walker simulated, " << entities_per_walker << " entities per walker ("
+			<< entity_bytes / count << " bytes)\n";
+
+		const char* json_file = "crowd_benchmark.json";
+		std::ofstream json(json_file);
+		json << "{\n  \"benchmark\": \"crowd\",\n  \"walkers\": " << count << ",\n  \"legs_per_walker\": " << desc.legs.size()
+			<< ",\n  \"frames\": " << frames << ",\n  \"ik_kernel\": \"" << IKSolverBatch::kernel_name() << "\""
+			<< ",\n  \"bytes_per_walker\": " << crowd_bytes / count << ",\n  \"entities_per_walker\": " << entities_per_walker
+			<< ",\n  \"entity_bytes_per_walker\": " << entity_bytes / count << ",\n  \"threads\": [";
+		for (std::size_t i = 0; i < results.size(); ++i)
+		{
+			const Result& result = results[i];
+			json << (i ? "," : "") << "\n    { \"threads\": " << result.threads << ", \"ms_per_frame\": " << result.total
+				<< ", \"speedup\": " << results[0].total / result.total << ", \"stages_ms\": { \"script\": " << result.stages.script
+				<< ", \"step\": " << result.stages.step << ", \"solve\": " << result.stages.solve << ", \"face\": " << result.stages.face
+				<< ", \"visuals\": " << result.visuals << ", \"transforms\": " << result.transforms << " } }";
+		}
+		json << "\n  ]\n}\n";
+		std::cout << "  results written to " << json_file << "\n";
+	}
+
+	// Downward ground queries for feet, grid against testing every segment, and what
+	// walking on terrain costs the rig over a flat floor
+	void terrain(std::size_t count)
+	{
+		if (count == 0) count = 20000;
+		const int repeats = 10;
+
+		// Long rolling heightfield with loose ledges scattered over it
+		std::mt19937 rng(1337);
+		const GLfloat spacing = 10.0f;
+		std::vector<GLfloat> heights(20000);
+		std::uniform_real_distribution<GLfloat> bump(-5.0f, 5.0f);
+		GLfloat height = 0.0f;
+		for (GLfloat& h : heights)
+			h = height = std::max(-400.0f, std::min(400.0f, height + bump(rng)));
+		const GLfloat width = spacing * (heights.size() - 1);
+
+		Terrain ground;
+		ground.add_heightfield(0.0f, spacing, heights);
+		std::uniform_real_distribution<GLfloat> along(0.0f, width), above(-800.0f, 0.0f), ledge(20.0f, 200.0f);
+		for (int i = 0; i < 2000; ++i)
+		{
+			const glm::vec2 a = { along(rng), above(rng) };
+			ground.add_segment(a, a + glm::vec2(ledge(rng), bump(rng) * 4.0f));
+		}
+		double build = best_time(repeats, [&] { ground.build(); });
+
+		std::vector<glm::vec2> feet(count);
+		for (glm::vec2& foot : feet)
+			foot = { along(rng), above(rng) - 200.0f };
+		const GLfloat max_distance = 2000.0f;
+
+		// Testing every segment is slow enough to only take a sample of the feet
+		const std::size_t sample = std::min<std::size_t>(count, 500);
+		std::vector<GLfloat> brute_y(sample);
+		double brute = best_time(1, [&]
+		{
+			for (std::size_t i = 0; i < sample; ++i)
+			{
+				brute_y[i] = feet[i].y + max_distance + 1.0f;
+				for (std::size_t s = 0; s < ground.segment_count(); ++s)
+				{
+					const glm::vec2 a = ground.segment_a(s), b = ground.segment_b(s);
+					if (feet[i].x < std::min(a.x, b.x) || feet[i].x > std::max(a.x, b.x) || a.x == b.x)
+						continue;
+					const GLfloat y = a.y + (feet[i].x - a.x) * (b.y - a.y) / (b.x - a.x);
+					if (y >= feet[i].y && y <= feet[i].y + max_distance)
+						brute_y[i] = std::min(brute_y[i], y);
+				}
+			}
+		}) * count / sample;
+
+		std::vector<TerrainHit> hits(count);
+		std::vector<std::uint8_t> hit(count);
+		double single = best_time(repeats, [&]
+		{
+			for (std::size_t i = 0; i < count; ++i)
+				hit[i] = ground.raycast_down(feet[i], max_distance, hits[i]);
+		});
+		double batched = best_time(repeats, [&]
+		{
+			ground.raycast_down(feet.data(), count, max_distance, hits.data(), hit.data());
+		});
+		double swept = best_time(repeats, [&]
+		{
+			TerrainHit sweep;
+			for (std::size_t i = 0; i < count; ++i)
+				ground.sweep_down(feet[i].x - 10.0f, feet[i].x + 10.0f, feet[i].y, max_distance, sweep);
+		});
+
+		std::size_t mismatches = 0, hit_count = 0;
+		for (std::size_t i = 0; i < count; ++i)
+			hit_count += hit[i];
+		for (std::size_t i = 0; i < sample; ++i)
+		{
+			const bool brute_hit = brute_y[i] <= feet[i].y + max_distance;
+			if (brute_hit != (hit[i] != 0) || (brute_hit && std::abs(brute_y[i] - hits[i].point.y) > 1e-3f))
+				++mismatches;
+		}
+
+		std::cout << "terrain: " << ground.segment_count() << " segments, " << count << " feet, " << hit_count << " on the ground, "
+			<< mismatches << " of " << sample << " differ from brute force\n"
+			<< "  build grid           " << build * 1e3 << " ms\n"
+			<< "  test every segment   " << brute * 1e3 << " ms (estimated from " << sample << " feet)\n"
+			<< "  raycast one by one   " << single * 1e3 << " ms (" << brute / single << "x)\n"
+			<< "  raycast batch        " << batched * 1e3 << " ms, " << batched * 1e9 / count << " ns per foot\n"
+			<< "  sweep 20 wide        " << swept * 1e3 << " ms\n";
+
+		// The same walkers on flat ground and on the heightfield
+		const WalkerDesc desc = WalkerDesc::make(6, 100.0f, 200.0f, Gait::tripod);
+		const std::size_t walkers = std::max<std::size_t>(count / 10, 1);
+		const Terrain* floors[] = { nullptr, &ground };
+		for (const Terrain* floor : floors)
+		{
+			WalkerRig rig;
+			rig.set_terrain(floor);
+			for (std::size_t i = 0; i < walkers; ++i)
+			{
+				const GLfloat x = width * (i + 0.5f) / walkers;
+				rig.add(desc, { x, -560.0f }, -400.0f);
+				rig.set_direction(i, { i % 2 ? -1.0f : 1.0f, 0.0f });
+			}
+			const int frames = 60;
+			double step = best_time(3, [&]
+			{
+				for (int frame = 0; frame < frames; ++frame)
+					rig.step(1.0f / 60.0f);
+			}) / frames;
+			std::cout << "  " << walkers << " walkers step on " << (floor ? "terrain " : "flat    ") << step * 1e3 << " ms per frame\n";
+		}
+
+		// Rows of hills stacked like the prototype's, every walker has to stay on its own
+		const GLfloat length = 200.0f, row_spacing = length * 3, hill_spacing = 100.0f;
+		const std::size_t rows = 5;
+		std::vector<GLfloat> hills(401);
+		const GLfloat hills_x0 = -hill_spacing * (hills.size() - 1) / 2;
+		auto row_ground = [&](std::size_t row, GLfloat x)
+		{
+			return length * 2 + row * row_spacing + 60.0f * std::sin(x / 500.0f) + 25.0f * std::sin(x / 170.0f + row);
+		};
+		Terrain stack;
+		for (std::size_t row = 0; row < rows; ++row)
+		{
+			for (std::size_t i = 0; i < hills.size(); ++i)
+				hills[i] = row_ground(row, hills_x0 + i * hill_spacing);
+			stack.add_heightfield(hills_x0, hill_spacing, hills);
+		}
+		stack.build();
+
+		// Spread over the middle half and turning every 1.5 s, so nobody walks off the end
+		const WalkerDesc stacked = WalkerDesc::make(4, length, 0.0f, Gait::tripod);
+		WalkerRig rig;
+		rig.set_terrain(&stack);
+		for (std::size_t i = 0; i < walkers; ++i)
+		{
+			const std::size_t row = i % rows;
+			const GLfloat x = hills_x0 * (0.5f - static_cast<GLfloat>(i) / walkers);
+			rig.add(stacked, { x, 20 + row * row_spacing }, row_ground(row, x));
+		}
+		for (int frame = 0; frame < 600; ++frame)
+		{
+			const GLfloat direction = frame / 90 % 2 ? -1.0f : 1.0f;
+			for (std::size_t i = 0; i < walkers; ++i)
+				rig.set_direction(i, { i % 2 ? -direction : direction, 0.0f });
+			rig.step(1.0f / 60.0f);
+		}
+
+		// Hills stay within 85 of a row's base, anything further away is another row
+		std::size_t strays = 0;
+		for (std::size_t i = 0; i < walkers; ++i)
+			strays += std::abs(rig.ground_y(i) - row_ground(i % rows, rig.position(i).x)) > 100.0f;
+		std::cout << "  " << walkers << " walkers on " << rows << " stacked rows, " << strays << " left their row after 10 s\n";
+	}
+
+	// Walkers sprinting back and forth at rising speeds, counting the leg-frames whose foot
+	// ended up out of reach and had its target clamped, with steps chasing the hip and with
+	// steps aimed at the hip's landing position
+	void sprint(std::size_t count)
+	{
+		if (count == 0) count = 1000;
+		const int frames = 600;
+		const GLfloat dt = 1.0f / 60.0f;
+
+		std::cout << "sprint: " << count << " walkers, 4 legs each, " << frames << " frames, turning every 1.5 s\n";
+		for (GLfloat speed : { 300.0f, 600.0f, 1500.0f, 3000.0f, 6000.0f })
+		{
+			for (bool predict : { false, true })
+			{
+				WalkerDesc desc = WalkerDesc::make(4, 200.0f, 200.0f, Gait::tripod);
+				desc.speed = speed;
+				desc.predict = predict;
+
+				// Hips 300 over the ground leave the feet 264 units of reach either way
+				WalkerRig rig;
+				for (std::size_t i = 0; i < count; ++i)
+					rig.add(desc, { i * 1000.0f, 0.0f }, 300.0f);
+
+				std::size_t clamped = 0;
+				double step = 0.0;
+				for (int frame = 0; frame < frames; ++frame)
+				{
+					const GLfloat direction = frame / 90 % 2 ? -1.0f : 1.0f;
+					for (std::size_t i = 0; i < count; ++i)
+						rig.set_direction(i, { direction, 0.0f });
+					auto start = Clock::now();
+					rig.step(dt);
+					step += std::chrono::duration<double>(Clock::now() - start).count();
+					clamped += IKSolverBatch::count_clamped(rig.solved().input());
+					rig.solve();
+				}
+
+				const double leg_frames = static_cast<double>(rig.leg_count()) * frames;
+				std::cout << "  speed " << speed << (predict ? " predicted " : " chasing   ") << 100.0 * clamped / leg_frames
+					<< "% leg-frames clamped, step " << step * 1e9 / frames / rig.leg_count() << " ns per leg\n";
+			}
+		}
+	}
+
+	struct Entry
+	{
+		const char* name;
+		void (*run)(std::size_t count);
+	};
+
+	const Entry entries[] =
+	{
+		{ "ik_batch", ik_batch },
+		{ "fabrik", fabrik },
+		{ "jobs", jobs },
+		{ "entities", entities },
+		{ "hierarchy", hierarchy },
+		{ "culling", culling },
+		{ "affine", affine },
+		{ "crowd", crowd },
+		{ "terrain", terrain },
+		{ "sprint", sprint },
+	};
+}
+
+int Benchmark::run(const std::string& name, std::size_t count)
+{
+	bool found = false;
+	for (const auto& entry : entries)
+	{
+		if (name == "all" || name == entry.name)
+		{
+			entry.run(count);
+			found = true;
+		}
+	}
+
+	if (!found)
+	{
+		std::cerr << "Unknown benchmark: " << name << "\nAvailable: all";
+		for (const auto& entry : entries)
+			std::cerr << " " << entry.name;
+		std::cerr << std::endl;
+		return 1;
+	}
+	return 0;
+}
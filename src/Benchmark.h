@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Throughput benchmarks, run with `TinyEngine --bench <name> [count]`.
+// `count` is the problem size (legs, chains, entities...), 0 picks the benchmark default.
+namespace Benchmark
+{
+	int run(const std::string& name, std::size_t count);
+}
@@ -4,6 +4,8 @@
 #include <glm/ext/matrix_clip_space.hpp>
 #include <glm/ext/matrix_transform.hpp>
 
+#include "affine.h"
+
 struct Camera
 {
 	glm::vec2 position = glm::vec2(0.0f);
@@ -13,17 +15,23 @@ struct Camera
 	GLfloat zoom_sensitivity = 15.f;
 	GLfloat pan_speed = 50.0f;
 
-	glm::mat4 get_orthographic_projection()
+	glm::mat4 get_orthographic_projection() const
 	{
 		return glm::ortho(0.0f, view_size.x, view_size.y, 0.0f, -1.0f, 1.0f);
 	}
-	glm::mat4 transform_view()
+	// translate(view_size * offset) * scale(zoom) * translate(-position)
+	Affine2 view_affine() const
 	{
-		glm::mat4 view = glm::mat4(1);
-		view = glm::translate(view, glm::vec3(view_size * offset, 0.0f));
-		view = glm::scale(view, glm::vec3(glm::vec2(zoom), 0.0f));
-		view = glm::translate(view, glm::vec3(-position, 0.0f));
-
-		return view;
+		const glm::vec2 t = view_size * offset - zoom * position;
+		return { zoom, 0.0f, 0.0f, zoom, t.x, t.y };
+	}
+	// World space area the view shows
+	Bounds visible_bounds() const
+	{
+		return view_affine().inverse().apply(Bounds{ glm::vec2(0.0f), view_size });
+	}
+	glm::mat4 transform_view() const
+	{
+		return view_affine().to_mat4();
 	}
 };
\ No newline at end of file
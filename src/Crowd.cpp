@@ -0,0 +1,118 @@
+#include "Crowd.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <cmath>
+#include <glm/gtc/constants.hpp>
+
+#include "math.h"
+
+namespace
+{
+	constexpr std::size_t walker_batch = 256;
+}
+
+Crowd::Crowd(const WalkerDesc& desc)
+	: desc_(desc)
+{
+}
+
+std::size_t Crowd::add(glm::vec2 position, GLfloat ground_y, bool scripted)
+{
+	const std::size_t walker = rig_.add(desc_, position, ground_y);
+
+	// Periods from 1 to 3 seconds and a start anywhere in them, spread by a hash of the index
+	const std::uint32_t hash = static_cast<std::uint32_t>(walker) * 2654435761u;
+	script_period_.push_back(scripted ? 1.0f + (hash >> 16) % 2000 / 1000.0f : 0.0f);
+	script_offset_.push_back((hash & 0xffff) / 65536.0f * 3.0f);
+
+	const glm::vec2 head = position - glm::vec2(0.0f, head_height);
+	head_.push_back(head);
+	eye1_.push_back(head + eye_offset);
+	eye2_.push_back(head - eye_offset);
+	return walker;
+}
+
+void Crowd::script(std::size_t begin, std::size_t end)
+{
+	for (std::size_t w = begin; w < end; ++w)
+	{
+		const GLfloat period = script_period_[w];
+		if (period == 0.0f)
+			continue;
+		const bool left = static_cast<std::int64_t>((time_ + script_offset_[w]) / period) % 2 != 0;
+		rig_.set_direction(w, { left ? -1.0f : 1.0f, 0.0f });
+	}
+}
+
+void Crowd::face(std::size_t begin, std::size_t end, GLfloat dt)
+{
+	// Same easing as the player's head in Prototype::update
+	const GLfloat t = dt * face_speed;
+	for (std::size_t w = begin; w < end; ++w)
+	{
+		const glm::vec2 root = rig_.position(w);
+		const glm::vec2 direction = rig_.direction(w);
+		glm::vec2& head = head_[w];
+		head.y = root.y - head_height;
+		head.x = ease_lerp(head.x, root.x + head_lead * direction.x, t);
+
+		eye1_[w] = ease_lerp(glm::vec2(eye1_[w].x, head.y), head + eye_offset, t) + direction;
+		eye2_[w] = ease_lerp(glm::vec2(eye2_[w].x, head.y), head - eye_offset, t);
+	}
+}
+
+void Crowd::update(GLfloat dt, JobSystem* jobs)
+{
+	PROFILE_ZONE("Crowd::update");
+	time_ += dt;
+	const std::size_t count = size();
+
+	auto for_walkers = [&](auto&& fn)
+	{
+		if (jobs)
+			jobs->parallel_for(count, walker_batch, fn);
+		else
+			fn(std::size_t(0), count);
+	};
+
+	std::uint64_t start = Profiler::now();
+	{
+		PROFILE_ZONE("Crowd::script");
+		for_walkers([&](std::size_t begin, std::size_t end) { script(begin, end); });
+	}
+	std::uint64_t end = Profiler::now();
+	timings_.script = (end - start) / 1e6;
+
+	start = end;
+	rig_.step(dt, jobs);
+	end = Profiler::now();
+	timings_.step = (end - start) / 1e6;
+
+	start = end;
+	rig_.solve(jobs);
+	end = Profiler::now();
+	timings_.solve = (end - start) / 1e6;
+
+	start = end;
+	{
+		PROFILE_ZONE("Crowd::face");
+		for_walkers([&](std::size_t begin, std::size_t end) { face(begin, end, dt); });
+	}
+	timings_.face = (Profiler::now() - start) / 1e6;
+}
+
+std::size_t Crowd::memory_bytes() const
+{
+	return rig_.memory_bytes() + (script_period_.capacity() + script_offset_.capacity()) * sizeof(GLfloat)
+		+ (head_.capacity() + eye1_.capacity() + eye2_.capacity()) * sizeof(glm::vec2);
+}
+
+void Crowd::snapshot(std::vector<GLfloat>& state) const
+{
+	rig_.snapshot(state);
+	state.push_back(time_);
+	for (const auto* values : { &head_, &eye1_, &eye2_ })
+		for (glm::vec2 value : *values)
+			state.insert(state.end(), { value.x, value.y });
+}
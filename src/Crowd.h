@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Walker.h"
+
+class JobSystem;
+
+// Milliseconds the last Crowd::update spent in each stage
+struct CrowdTimings
+{
+	double script = 0.0, step = 0.0, solve = 0.0, face = 0.0;
+
+	double total() const { return script + step + solve + face; }
+};
+
+// Walkers with the Prototype creature's head and eyes, all of one kind. Scripted walkers
+// pace back and forth on their own periods, the others take set_direction() like the
+// player. Everything is simulation, drawing is left to the game.
+class Crowd
+{
+public:
+	// Head placement, the head leads the body by head_lead in the walking direction
+	GLfloat head_height = 200.0f;
+	GLfloat head_lead = 96.0f;
+	glm::vec2 eye_offset = { 40.0f, 0.0f };
+	GLfloat face_speed = 20.0f;
+
+	explicit Crowd(const WalkerDesc& desc);
+
+	std::size_t add(glm::vec2 position, GLfloat ground_y, bool scripted);
+	// See WalkerRig::set_terrain
+	void set_terrain(const Terrain* terrain) { rig_.set_terrain(terrain); }
+	void set_direction(std::size_t walker, glm::vec2 direction) { rig_.set_direction(walker, direction); }
+
+	void update(GLfloat dt, JobSystem* jobs = nullptr);
+	const CrowdTimings& timings() const { return timings_; }
+
+	std::size_t size() const { return rig_.walker_count(); }
+	const WalkerRig& rig() const { return rig_; }
+	glm::vec2 head(std::size_t walker) const { return head_[walker]; }
+	glm::vec2 eye1(std::size_t walker) const { return eye1_[walker]; }
+	glm::vec2 eye2(std::size_t walker) const { return eye2_[walker]; }
+
+	// Heap bytes held by the crowd and its rig
+	std::size_t memory_bytes() const;
+	// See WalkerRig::snapshot, heads and eyes included
+	void snapshot(std::vector<GLfloat>& state) const;
+
+private:
+	void script(std::size_t begin, std::size_t end);
+	void face(std::size_t begin, std::size_t end, GLfloat dt);
+
+	WalkerDesc desc_;
+	WalkerRig rig_;
+	GLfloat time_ = 0.0f;
+	CrowdTimings timings_;
+
+	// Per walker. Period 0 marks walkers steered from outside.
+	std::vector<GLfloat> script_period_, script_offset_;
+	std::vector<glm::vec2> head_, eye1_, eye2_;
+};
@@ -1,14 +1,32 @@
 #include "Engine.h"
 #include "Mouse.h"
+#include "Profiler.h"
+#include "ShaderCache.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 
-Engine::Engine(GLuint width, GLuint height)
-	: width(width), height(height)
+
+Engine::Engine(GLuint width, GLuint height, EngineConfig config)
+	: width(width), height(height), config(config)
 {
 };
 
 Engine::~Engine()
 {
+	if (recorder)
+		recorder->write(config.record_file);
+	if (replay && replay->ticks_applied() > 0)
+	{
+		std::printf("replay: %llu of %llu ticks played", static_cast<unsigned long long>(replay->ticks_applied()),
+			static_cast<unsigned long long>(replay->tick_count()));
+		if (replay->has_state())
+			std::printf(", state differed from the recording on %llu", static_cast<unsigned long long>(replay_mismatches_));
+		std::printf("\n");
+	}
+
 	/*
 	delete &quad_mat;
 	delete &circ_mat;
@@ -19,113 +37,376 @@ Engine::~Engine()
 
 void Engine::init()
 {
-	window = std::make_unique<Window>("TinyEngine", width, height);
-	renderer = std::make_unique<SpriteRenderer>();
+	init_start_time_ = Profiler::now();
+	jobs = std::make_unique<JobSystem>(config.thread_count, config.deterministic_jobs);
 	camera = std::make_unique<Camera>();
+	delta_time = 1.0f / config.tick_rate;
+
+	if (!config.replay_file.empty())
+	{
+		// A log that will not open plays zero ticks, so the run ends right away
+		replay = std::make_unique<ReplayLog>();
+		if (replay->open(config.replay_file))
+			delta_time = 1.0f / replay->tick_rate();
+	}
+	if (!config.record_file.empty())
+		recorder = std::make_unique<ReplayRecorder>(1.0f / delta_time, config.record_state);
+
+	if (config.headless)
+	{
+		// Materials only carry colors for the game code, nothing is ever bound
+		quad_shader = circ_shader = ghost_shader = nullptr;
+		texture_a = texture_b = nullptr;
+		quad_mat = new Material(nullptr, nullptr, 0);
+		circ_mat = new Material(nullptr, nullptr, 0);
+		circ_mat2 = new Material(nullptr, nullptr, 0);
+		return;
+	}
 
-	// Shaders
-	auto vs_file_name = "res/Shaders/sprite.vs";
-	auto quad_fs_file_name = "res/Shaders/sprite.fs";
-	auto circ_fs_file_name = "res/Shaders/circle.fs";
-
-
-	quad_shader = new Shader();
-	quad_shader->load(vs_file_name, quad_fs_file_name);
-
-	circ_shader = new Shader();
-	circ_shader->load(vs_file_name, circ_fs_file_name);
-
-
-	auto projection = camera->get_orthographic_projection();
-
-	quad_shader->use();
-	quad_shader->set_mat4("u_projection", projection);
-
-	circ_shader->use();
-	circ_shader->set_mat4("u_projection", projection);
-	circ_shader->set_vec2f("u_screenResolution", (float)width, (float)height);
-
+	window = std::make_unique<Window>("TinyEngine", width, height);
+	ShaderCache::init(reinterpret_cast<GLADloadproc>(glfwGetProcAddress), config.shader_cache);
+
+	gl_profiler = std::make_unique<GLProfiler>();
+	clear_pass = gl_profiler->add_pass("clear");
+	sprite_pass = gl_profiler->add_pass("sprites");
+	if (!config.gl_stats_csv.empty())
+		gl_profiler->open_csv(config.gl_stats_csv);
+	if (config.instanced_rendering)
+		instanced_renderer = std::make_unique<InstancedRenderer>(10000);
+	else
+		renderer = std::make_unique<Renderer>(Renderer::sprite_attributes, 10000);
+
+	// Shaders, both paths share the fragment shaders
+	auto vs_file_name = config.instanced_rendering ? "res/Shaders/sprite_instanced.vs" : "res/Shaders/sprite_batch.vs";
+	auto quad_fs_file_name = "res/Shaders/sprite_batch.fs";
+	auto circ_fs_file_name = "res/Shaders/circle_batch.fs";
+
+
+	// One mapped file instead of a decode per image, everything below falls back to res when it is missing
+	if (!config.asset_pack.empty() && !pack.open(config.asset_pack))
+		std::printf("No asset pack at %s, loading loose files\n", config.asset_pack.c_str());
+	// Edits in res win over an old pack, until the next --cook
+	if (const PackEntry* stale = pack.is_open() ? pack.stale_entry() : nullptr)
+	{
+		std::printf("%s changed after %s was cooked, loading loose files\n", stale->name, config.asset_pack.c_str());
+		pack.close();
+	}
+
+	quad_shader = load_shader(vs_file_name, quad_fs_file_name);
+	circ_shader = load_shader(vs_file_name, circ_fs_file_name);
+
+	if (config.watch_shaders)
+	{
+		shader_watcher = std::make_unique<ShaderWatcher>();
+		shader_watcher->watch(quad_shader);
+		shader_watcher->watch(circ_shader);
+	}
+
+	// View, projection and screen size for every shader
+	camera_buffer = std::make_unique<CameraBuffer>();
+
+	// Textures decode in the background and show a placeholder until render() has uploaded them
+	assets = std::make_unique<AssetLoader>(config.asset_threads, config.texture_upload_budget, pack.is_open() ? &pack : nullptr);
 	// Texture white
-	texture_a = new Texture();
-	texture_a->load("res/Images/white.png");
+	texture_a = assets->load_texture("res/Images/white.png");
 	// Texture png
-	texture_b = new Texture();
-	texture_b->load("res/Images/beyer.jpg");
+	texture_b = assets->load_texture("res/Images/beyer.jpg");
 
 	// Materials
 	quad_mat = new Material(texture_a, quad_shader, 0);
 	circ_mat = new Material(texture_a, circ_shader, 0);
 	circ_mat2 = new Material(texture_a, circ_shader, 0);
+
+	last_frame_time_ = glfwGetTime();
 }
 
+Shader* Engine::load_shader(const char* vs_file_name, const char* fs_file_name)
+{
+	Shader* shader = new Shader();
+	const PackEntry* vs = pack.is_open() ? pack.find(vs_file_name, PackEntry::text) : nullptr;
+	const PackEntry* fs = pack.is_open() ? pack.find(fs_file_name, PackEntry::text) : nullptr;
+	if (vs && fs)
+		shader->load_source(vs_file_name, pack.text(*vs), fs_file_name, pack.text(*fs));
+	else
+		shader->load(vs_file_name, fs_file_name);
+	return shader;
+}
 
-void Engine::handle_input()
+void Engine::build_atlas()
 {
-	window->process_events();
+	PROFILE_ZONE("Engine::build_atlas");
+
+	// Sprite images, packed into shared pages
+	atlas = std::make_unique<TextureAtlas>();
+	add_atlas_image("white", "res/Images/white.png");
+	add_atlas_image("beyer", "res/Images/beyer.jpg");
+	add_atlas_image("grid", "res/Images/grid.png");
+	add_atlas_image("testtexture", "res/Images/testtexture.png");
+	atlas->build(jobs.get());
+	for (std::size_t page = 0; page < atlas->page_count(); ++page)
+		atlas_materials_.push_back(std::make_unique<Material>(atlas->page(page), quad_shader, 0));
 }
 
-double old_time = 0;
-void Engine::update()
+void Engine::add_atlas_image(const std::string& name, const std::string& file_name)
 {
-	// delta time
-	double time = glfwGetTime();
-	delta_time = static_cast<GLfloat>(time - old_time);
+	const PackEntry* entry = pack.is_open() ? pack.find(file_name, PackEntry::image_rgba8) : nullptr;
+	if (!entry)
+	{
+		atlas->add(name, file_name);
+		return;
+	}
+	// Level 0 only, the pages build their own mipmaps
+	const unsigned char* pixels = pack.data(*entry);
+	atlas->add(name, entry->width, entry->height,
+		std::vector<unsigned char>(pixels, pixels + static_cast<std::size_t>(entry->width) * entry->height * 4));
+}
+
 
+bool Engine::is_running()
+{
+	if (replay)
+		return !replay->finished() && (config.headless || window->is_open());
+	if (config.headless)
+		return config.headless_ticks == 0 || tick < config.headless_ticks;
+	return window->is_open();
+}
+
+void Engine::handle_input()
+{
+	if (config.headless)
+		return;
+
+	window->process_events();
 
-	// update camera
-	// Zoom
-	camera->zoom = lerp(camera->zoom, camera->zoom + static_cast<GLfloat>(Mouse::get_scroll_dy()), camera->zoom_sensitivity * delta_time);
+	// update camera, once per frame since it only affects presentation
+	// Zoom, eased over the real length of the last frame
+	camera->zoom = lerp(camera->zoom, camera->zoom + static_cast<GLfloat>(Mouse::get_scroll_dy()), std::min(camera->zoom_sensitivity * frame_delta_time, 1.0f));
 	//  Pan
 	if (Mouse::button(1))
 		camera->position += glm::vec2(Mouse::get_mouse_dx(), Mouse::get_mouse_dy());
+}
 
-	// Update objects
-	for (const auto& entry : objects)
-		entry->update(delta_time);
+unsigned Engine::advance_frame()
+{
+	if (config.headless)
+		return 1;
+
+	const double time = glfwGetTime(), frame = time - last_frame_time_;
+	frame_delta_time = static_cast<GLfloat>(frame);
+	last_frame_time_ = time;
+
+	// Replays step like headless runs, so every frame shows the same tick every time
+	if (replay)
+		return 1;
+
+	accumulator_ += frame;
+
+	unsigned ticks = 0;
+	while (accumulator_ >= delta_time && ticks < config.max_catch_up_ticks)
+	{
+		accumulator_ -= delta_time;
+		++ticks;
+	}
+
+	// Too far behind, drop whole ticks and keep the fraction
+	if (accumulator_ >= delta_time)
+	{
+		const double behind = std::floor(accumulator_ / delta_time);
+		dropped_ticks += static_cast<std::uint64_t>(behind);
+		accumulator_ -= behind * delta_time;
+	}
+
+	interpolation_alpha = static_cast<GLfloat>(accumulator_ / delta_time);
+	return ticks;
+}
 
-	old_time = time;
+void Engine::begin_tick()
+{
+	if (replay)
+		replay->apply(*camera);
+	else if (config.headless)
+		config.input_script.apply(tick);
+	if (recorder)
+		recorder->record_input(*camera);
+
+	entities.store_previous_transforms();
+}
+
+void Engine::update()
+{
+	entities.update_world_transforms();
+
+	// Not on a tick the replay could not read
+	const bool check_replay = replay && replay->has_state() && replay->ticks_applied() > tick;
+	if ((recorder && recorder->records_state()) || check_replay)
+	{
+		state_.clear();
+		if (snapshot)
+			snapshot(state_);
+		if (recorder)
+			recorder->record_state(state_);
+	}
+	if (check_replay)
+	{
+		// Bit for bit, a replay of a deterministic run lands on the very same floats
+		const std::vector<GLfloat>& recorded = replay->state();
+		if (recorded.size() != state_.size() || (!state_.empty() && std::memcmp(recorded.data(), state_.data(), state_.size() * sizeof(GLfloat)) != 0))
+		{
+			if (replay_mismatches_++ == 0)
+				std::printf("replay: state differs from the recording from tick %llu on\n", static_cast<unsigned long long>(tick));
+		}
+	}
+	++tick;
 }
 
 void Engine::draw_circle(glm::vec2 pos, GLfloat size)
 {
+	if (config.headless)
+		return;
+
 	auto circ = std::make_shared<struct Drawable>();
 	circ->material = circ_mat;
 	circ->position = pos;
 	circ->size *= size;
 
-	renderer->draw(*circ, camera->transform_view());
+	if (instanced_renderer)
+		instanced_renderer->draw(*circ);
+	else
+		renderer->draw(*circ);
 }
 
 void Engine::render()
 {
-	window->clear();
+	if (config.headless)
+		return;
 
-	for (auto& game_object : objects)
-		game_object->draw(*renderer, camera->transform_view());
+	// Saved shaders swap in before anything draws with them
+	if (shader_watcher)
+		shader_watcher->poll();
+
+	// Streamed textures, within the per frame budget
+	assets->update();
+
+	gl_profiler->begin_pass(clear_pass);
+	window->clear();
 
+	gl_profiler->begin_pass(sprite_pass);
+
+	// Only what the camera sees, those drawables sit between the last two ticks
+	entities.query_visible(camera->visible_bounds(), visible_);
+	entities.sync_drawables(*jobs, visible_, interpolation_alpha);
+
+	GLStateStats& stats = GLState::counters();
+	stats.sprites_visible += static_cast<GLuint>(visible_.size());
+	stats.sprites_culled += static_cast<GLuint>(entities.size() - visible_.size());
+
+	// Once per frame, unchanged cameras skip the upload
+	camera_buffer->update(*camera, glm::vec2(width, height));
+
+	const auto& drawables = entities.drawables();
+	auto view = camera->view_affine();
+	if (instanced_renderer)
+	{
+		instanced_renderer->begin(view);
+		for (std::uint32_t i : visible_)
+			instanced_renderer->draw(drawables[i]);
+		instanced_renderer->end();
+	}
+	else
+	{
+		renderer->begin(view);
+		for (std::uint32_t i : visible_)
+			renderer->draw(drawables[i]);
+		renderer->end();
+	}
+
+	gl_profiler->end_pass();
 	window->update();
 }
 
+void Engine::end_frame()
+{
+	// Elided binds and uploads for this frame are in GLState::last_frame()
+	GLState::end_frame();
+	if (gl_profiler)
+		gl_profiler->end_frame();
+	Profiler::end_frame();
+
+	if (window && !textures_reported_)
+	{
+		const double ms = (Profiler::now() - init_start_time_) / 1e6;
+		const char* source = pack.is_open() ? "asset pack" : "loose files";
+		if (!first_frame_reported_)
+		{
+			first_frame_reported_ = true;
+			std::printf("startup: first frame after %.1f ms from %s\n", ms, source);
+		}
+		if (assets->pending() == 0)
+		{
+			textures_reported_ = true;
+			std::printf("startup: all textures in after %.1f ms from %s\n", ms, source);
+		}
+	}
+
+	// Frame stats overlay in the title bar, refreshed twice a second
+	if (window && Profiler::enabled() && Profiler::now() - last_overlay_time_ > 500000000)
+	{
+		last_overlay_time_ = Profiler::now();
+		FrameStats stats = Profiler::frame_stats();
+		const GLFrameStats& gl = gl_profiler->last_frame();
+		char title[224];
+		std::snprintf(title, sizeof(title), "TinyEngine | frame ms min %.2f avg %.2f p99 %.2f max %.2f | gpu %.2f ms, %u draws | %u visible, %u culled",
+			stats.min, stats.avg, stats.p99, stats.max, gl.gpu_ms, gl.calls.draw_calls, gl.calls.sprites_visible, gl.calls.sprites_culled);
+		window->set_title(title);
+	}
+}
+
 std::shared_ptr<GameObject> Engine::add_game_object()
 {
-	auto go = std::make_shared<GameObject>();
+	auto go = std::make_shared<GameObject>(entities, entities.create());
 	objects.push_back(go);
-	go->start();
 
 	return go;
 }
 
 std::shared_ptr<GameObject> Engine::add_circle_object(GLfloat size)
 {
-	auto go = std::make_shared<GameObject>();
-	objects.push_back(go);
+	auto go = add_game_object();
 
-	auto circ = std::make_shared<struct Drawable>();
-	circ->material = circ_mat2;
-	circ->size *= size;
+	auto& circ = go->drawable();
+	circ.material = circ_mat2;
+	circ.size *= size;
 
-	go->drawable = *circ;
-	go->start();
+	return go;
+}
+
+std::shared_ptr<GameObject> Engine::add_sprite_object(const std::string& region_name)
+{
+	auto go = add_game_object();
+	if (!atlas && !config.headless)
+		build_atlas();
+	const AtlasRegion* region = atlas ? atlas->find(region_name) : nullptr;
+	if (!region)
+	{
+		// Headless or unknown image, a plain quad keeps it visible
+		go->drawable().material = quad_mat;
+		return go;
+	}
+
+	std::size_t page = 0;
+	while (atlas->page(page) != region->texture)
+		++page;
+
+	auto& sprite = go->drawable();
+	sprite.material = atlas_materials_[page].get();
+	sprite.uv_rect = region->uv;
+	sprite.size = glm::vec2(region->width, region->height);
 
 	return go;
 }
+
+void Engine::remove_game_object(const std::shared_ptr<GameObject>& go)
+{
+	entities.destroy(go->entity);
+	objects.erase(std::remove(objects.begin(), objects.end(), go), objects.end());
+}
@@ -1,19 +1,100 @@
 #pragma once
 
+#include <functional>
+
+#include "AssetLoader.h"
+#include "AssetPack.h"
+#include "camera_buffer.h"
+#include "EntityStore.h"
 #include "game_object.h"
+#include "GLProfiler.h"
+#include "InputScript.h"
+#include "JobSystem.h"
 #include "Mouse.h"
+#include "Replay.h"
+#include "ShaderWatcher.h"
+#include "TextureAtlas.h"
 #include "Window.h"
 #include "renderer.h"
 
+// Options that have to be known before Engine::init
+struct EngineConfig
+{
+	// Worker threads for jobs, 0 uses every hardware thread
+	unsigned thread_count = 0;
+	bool deterministic_jobs = false;
+
+	// Draw through InstancedRenderer instead of the CPU batcher
+	bool instanced_rendering = false;
+
+	// Simulation ticks per second. Frames run as many fixed ticks as real time asks for,
+	// at most max_catch_up_ticks, anything beyond that is dropped to keep a hitch bounded.
+	GLfloat tick_rate = 60.0f;
+	unsigned max_catch_up_ticks = 5;
+
+	// No window and no GL: every frame runs exactly one tick and input comes from
+	// input_script, as fast as the CPU allows. Stops after headless_ticks, 0 runs forever.
+	bool headless = false;
+	std::uint64_t headless_ticks = 600;
+	InputScript input_script = InputScript::walk_back_and_forth(120);
+
+	// Cooked images and shaders, see AssetCooker. Loose files in res are used when the pack
+	// is missing, older than any of its sources, or empty here.
+	std::string asset_pack = "res/assets.pack";
+
+	// Linked shader binaries are kept here between launches, empty disables the cache
+	std::string shader_cache = "shader_cache";
+
+	// Rebuild shaders from res/Shaders when they are saved, for iterating on them
+	bool watch_shaders = false;
+
+	// Texture decode threads and bytes streamed to the GPU per frame
+	unsigned asset_threads = 1;
+	std::size_t texture_upload_budget = 4 << 20;
+
+	// Per frame GL counters and GPU pass times are appended here when set
+	std::string gl_stats_csv;
+
+	// Every tick's keyboard, mouse and camera are written here on exit when set, and with
+	// record_state the game's state after each tick too
+	std::string record_file;
+	bool record_state = false;
+	// Plays a recording back in place of live or scripted input, one tick per frame at the
+	// recorded tick rate until it ends, and checks the game's state against the recorded one
+	std::string replay_file;
+};
+
 struct Engine
 {
-	Engine(GLuint width, GLuint height);
+	Engine(GLuint width, GLuint height, EngineConfig config = {});
 	~Engine();
 	GLuint width, height;
+	EngineConfig config;
 
 	std::unique_ptr<Window> window;
-	std::unique_ptr <SpriteRenderer> renderer;
+	std::unique_ptr <Renderer> renderer;
+	std::unique_ptr<InstancedRenderer> instanced_renderer;
 	std::unique_ptr <Camera> camera;
+	// Mapped config.asset_pack, closed when there is none
+	AssetPack pack;
+	// Streams textures in, null when headless
+	std::unique_ptr<AssetLoader> assets;
+	// Every image in res/Images, packed when the first sprite asks for it. Null until then
+	// and when headless.
+	std::unique_ptr<TextureAtlas> atlas;
+	// Set with config.watch_shaders, null otherwise
+	std::unique_ptr<ShaderWatcher> shader_watcher;
+	// Camera uniform block shared by all shaders, null when headless
+	std::unique_ptr<CameraBuffer> camera_buffer;
+	std::unique_ptr<JobSystem> jobs;
+	// GPU timings and GL call counts, null when headless
+	std::unique_ptr<GLProfiler> gl_profiler;
+	// Set with config.record_file and config.replay_file, null otherwise
+	std::unique_ptr<ReplayRecorder> recorder;
+	std::unique_ptr<ReplayLog> replay;
+	// Appends the game's state, for recording it and checking replays against it
+	std::function<void(std::vector<GLfloat>&)> snapshot;
+	std::size_t clear_pass = 0, sprite_pass = 0;
 
 	//research unique ptr, shared ptr
 	Shader* quad_shader;
@@ -27,16 +108,65 @@ struct Engine
 	Texture* texture_a;
 	Texture* texture_b;
 
+	// Fixed length of a tick, every update sees this
 	GLfloat delta_time = 0.0f;
+	// Ticks run so far
+	std::uint64_t tick = 0;
+	// Ticks thrown away because a frame fell more than max_catch_up_ticks behind
+	std::uint64_t dropped_ticks = 0;
+	// How far real time is between the last tick and the next one, render blends by it
+	GLfloat interpolation_alpha = 1.0f;
+	// Real time the last frame took, for things that follow the display instead of ticks
+	GLfloat frame_delta_time = 0.0f;
 
 	void init();
+	bool is_running();
 	void handle_input();
+	// Ticks to run this frame
+	unsigned advance_frame();
+	// Call before the game's update of every tick
+	void begin_tick();
 	void update();
 	void render();
+	// Closes the frame for the GL counters and the profiler
+	void end_frame();
+	// Queues into the current batch, only valid while render() is running
 	void draw_circle(glm::vec2 pos, GLfloat size);
 
+	// Components of every object, updated and drawn straight from its dense arrays
+	EntityStore entities;
+
+	// Handles created through add_game_object, in creation order
 	std::vector<std::shared_ptr<GameObject>> objects;
 	std::shared_ptr<GameObject> add_game_object();
 	std::shared_ptr<GameObject> add_circle_object(GLfloat scale);
-	//void remove_game_object(const std::shared_ptr<GameObject>& go);
+	// Quad showing an atlas image at its pixel size. Sprites on one atlas page share a
+	// material, so they batch into a single draw whatever image they show.
+	std::shared_ptr<GameObject> add_sprite_object(const std::string& region_name);
+	void remove_game_object(const std::shared_ptr<GameObject>& go);
+
+private:
+	// From the pack when it has both sources, otherwise from the files
+	Shader* load_shader(const char* vs_file_name, const char* fs_file_name);
+	// Packs the sprite images, run by the first add_sprite_object so games without sprites
+	// never decode them
+	void build_atlas();
+	// Queues an image on the atlas, decoded already when it comes from the pack
+	void add_atlas_image(const std::string& name, const std::string& file_name);
+
+	// Startup timing, reported once the first frame is out and once every texture is in
+	std::uint64_t init_start_time_ = 0;
+	bool first_frame_reported_ = false, textures_reported_ = false;
+
+	double last_frame_time_ = 0.0;
+	double accumulator_ = 0.0;
+
+	// Game state after the current tick, and ticks a replay ended up somewhere else than recorded
+	std::vector<GLfloat> state_;
+	std::uint64_t replay_mismatches_ = 0;
+	std::uint64_t last_overlay_time_ = 0;
+	// Dense indices render draws this frame
+	std::vector<std::uint32_t> visible_;
+	// One quad material per atlas page
+	std::vector<std::unique_ptr<Material>> atlas_materials_;
 };
@@ -0,0 +1,421 @@
+#include "EntityStore.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <glm/gtc/constants.hpp>
+#include <utility>
+
+namespace
+{
+	// Elements per job, copying transforms is cheap so batches are large
+	constexpr std::size_t sync_batch = 4096;
+	constexpr std::size_t ik_batch = 1024;
+
+	template <typename T>
+	void move_last_into(std::vector<T>& values, std::size_t index)
+	{
+		values[index] = std::move(values.back());
+		values.pop_back();
+	}
+}
+
+// Out of line definition, push_back takes npos by reference (needed before C++17)
+constexpr std::uint32_t EntityStore::npos;
+
+Entity EntityStore::create()
+{
+	std::uint32_t index;
+	if (!free_slots_.empty())
+	{
+		index = free_slots_.back();
+		free_slots_.pop_back();
+	}
+	else
+	{
+		index = static_cast<std::uint32_t>(slots_.size());
+		slots_.emplace_back();
+	}
+
+	Slot& slot = slots_[index];
+	slot.dense = static_cast<std::uint32_t>(entities_.size());
+	slot.chain = npos;
+
+	Entity entity{ index, slot.generation };
+	entities_.push_back(entity);
+	parents_.emplace_back();
+	parent_indices_.push_back(npos);
+	child_counts_.push_back(0);
+	dirty_.push_back(1);
+	positions_.emplace_back(0.0f);
+	rotations_.push_back(0.0f);
+	scales_.push_back(1.0f);
+	drawables_.push_back(Drawable{});
+	world_positions_.emplace_back(0.0f);
+	world_rotations_.push_back(0.0f);
+	world_scales_.push_back(1.0f);
+	previous_positions_.emplace_back(0.0f);
+	previous_rotations_.push_back(0.0f);
+	placed_.push_back(0);
+	draw_orders_.push_back(next_draw_order_++);
+	return entity;
+}
+
+void EntityStore::destroy(Entity entity)
+{
+	if (!alive(entity))
+		return;
+
+	Slot& slot = slots_[entity.index];
+	if (slot.chain != npos)
+		remove_ik_chain(slot.chain);
+
+	grid_.remove(entity.index);
+
+	const std::uint32_t dense = slot.dense;
+	if (parents_[dense].index != Entity::invalid)
+		--child_counts_[slots_[parents_[dense].index].dense];
+
+	// Children become roots where they are
+	for (std::size_t i = 0; child_counts_[dense] > 0 && i < parents_.size(); ++i)
+	{
+		if (parents_[i] != entity)
+			continue;
+		parents_[i] = Entity{};
+		positions_[i] = world_positions_[i];
+		rotations_[i] = world_rotations_[i];
+		scales_[i] = world_scales_[i];
+		dirty_[i] = 1;
+		--child_counts_[dense];
+	}
+
+	// Move the last entity into the hole, which may put it in front of its parent
+	hierarchy_changed_ = true;
+	slots_[entities_.back().index].dense = dense;
+	for_each_array([dense](auto& values) { move_last_into(values, dense); });
+
+	slot.dense = npos;
+	slot.chain = npos;
+	++slot.generation;
+	free_slots_.push_back(entity.index);
+}
+
+bool EntityStore::alive(Entity entity) const
+{
+	return entity.index < slots_.size() && slots_[entity.index].generation == entity.generation
+		&& slots_[entity.index].dense != npos;
+}
+
+void EntityStore::reserve(std::size_t count)
+{
+	slots_.reserve(count);
+	for_each_array([count](auto& values) { values.reserve(count); });
+}
+
+std::uint32_t EntityStore::dense_index(Entity entity) const
+{
+	assert(alive(entity) && "stale or invalid entity handle");
+	return slots_[entity.index].dense;
+}
+
+std::uint32_t EntityStore::parent_dense(std::size_t dense) const
+{
+	const Entity parent = parents_[dense];
+	return parent.index == Entity::invalid ? npos : slots_[parent.index].dense;
+}
+
+TransformRef EntityStore::transform(Entity entity)
+{
+	const std::uint32_t i = dense_index(entity);
+	dirty_[i] = 1;
+	return { positions_[i], rotations_[i], scales_[i] };
+}
+
+Transform EntityStore::world_transform(Entity entity) const
+{
+	const std::uint32_t i = dense_index(entity);
+	return { world_positions_[i], world_rotations_[i], world_scales_[i] };
+}
+
+bool EntityStore::set_parent(Entity child, Entity parent)
+{
+	const std::uint32_t i = dense_index(child);
+	if (parent.index != Entity::invalid)
+	{
+		// Walk up from the new parent, finding the child there means a cycle
+		for (std::uint32_t p = dense_index(parent); p != npos; p = parent_dense(p))
+			if (p == i)
+				return false;
+		++child_counts_[slots_[parent.index].dense];
+	}
+	if (parents_[i].index != Entity::invalid)
+		--child_counts_[slots_[parents_[i].index].dense];
+
+	parents_[i] = parent;
+	dirty_[i] = 1;
+	hierarchy_changed_ = true;
+	return true;
+}
+
+Entity EntityStore::parent(Entity entity) const
+{
+	return parents_[dense_index(entity)];
+}
+
+void EntityStore::mark_all_dirty()
+{
+	std::fill(dirty_.begin(), dirty_.end(), 1);
+}
+
+void EntityStore::sort_by_depth()
+{
+	PROFILE_ZONE("EntityStore::sort_by_depth");
+
+	// Depth of every entity, filled in while walking up to the first known ancestor
+	const std::size_t count = size();
+	const std::uint32_t unknown = npos;
+	std::vector<std::uint32_t> depth(count, unknown);
+	std::vector<std::uint32_t> path;
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		std::uint32_t p = static_cast<std::uint32_t>(i);
+		while (p != npos && depth[p] == unknown)
+		{
+			path.push_back(p);
+			p = parent_dense(p);
+		}
+		std::uint32_t d = p == npos ? 0 : depth[p] + 1;
+		for (auto it = path.rbegin(); it != path.rend(); ++it)
+			depth[*it] = d++;
+		path.clear();
+	}
+
+	std::vector<std::uint32_t> order(count);
+	for (std::size_t i = 0; i < count; ++i)
+		order[i] = static_cast<std::uint32_t>(i);
+	std::stable_sort(order.begin(), order.end(), [&depth](std::uint32_t a, std::uint32_t b) { return depth[a] < depth[b]; });
+
+	for_each_array([&order](auto& values)
+	{
+		auto sorted = values;
+		for (std::size_t i = 0; i < order.size(); ++i)
+			sorted[i] = std::move(values[order[i]]);
+		values.swap(sorted);
+	});
+
+	for (std::size_t i = 0; i < count; ++i)
+		slots_[entities_[i].index].dense = static_cast<std::uint32_t>(i);
+}
+
+bool EntityStore::link_parents()
+{
+	bool sorted = true;
+	for (std::size_t i = 0; i < size(); ++i)
+	{
+		parent_indices_[i] = parent_dense(i);
+		if (parent_indices_[i] != npos && parent_indices_[i] > i)
+			sorted = false;
+	}
+	return sorted;
+}
+
+std::size_t EntityStore::update_world_transforms()
+{
+	PROFILE_ZONE("EntityStore::update_world_transforms");
+
+	if (hierarchy_changed_)
+	{
+		if (!link_parents())
+		{
+			sort_by_depth();
+			link_parents();
+		}
+		hierarchy_changed_ = false;
+	}
+
+	// Parents come first, so a dirty parent has already flagged itself when its children are visited
+	std::size_t updated = 0;
+	for (std::size_t i = 0; i < size(); ++i)
+	{
+		const std::uint32_t p = parent_indices_[i];
+		if (!dirty_[i] && (p == npos || !dirty_[p]))
+			continue;
+
+		dirty_[i] = 1;
+		++updated;
+		if (p == npos)
+		{
+			world_positions_[i] = positions_[i];
+			world_rotations_[i] = rotations_[i];
+			world_scales_[i] = scales_[i];
+		}
+		else
+		{
+			const GLfloat s = std::sin(world_rotations_[p]);
+			const GLfloat c = std::cos(world_rotations_[p]);
+			const glm::vec2 local = positions_[i] * world_scales_[p];
+			world_positions_[i] = world_positions_[p] + glm::vec2(c * local.x - s * local.y, s * local.x + c * local.y);
+			world_rotations_[i] = world_rotations_[p] + rotations_[i];
+			world_scales_[i] = world_scales_[p] * scales_[i];
+		}
+		if (!placed_[i])
+		{
+			previous_positions_[i] = world_positions_[i];
+			previous_rotations_[i] = world_rotations_[i];
+			placed_[i] = 1;
+		}
+
+		// Bounding circle of the drawable, the quad's centre sits (0.5 - origin) * size from the pivot
+		const Drawable& drawable = drawables_[i];
+		const glm::vec2 offset = (glm::vec2(0.5f) - drawable.origin_fraction()) * drawable.size;
+		glm::vec2 center = world_positions_[i];
+		if (drawable.transform_origin != Drawable::centered)
+		{
+			const GLfloat s = std::sin(world_rotations_[i]);
+			const GLfloat c = std::cos(world_rotations_[i]);
+			center += glm::vec2(c * offset.x - s * offset.y, s * offset.x + c * offset.y);
+		}
+		grid_.update(entities_[i].index, center, 0.5f * glm::length(drawable.size));
+	}
+
+	std::fill(dirty_.begin(), dirty_.end(), 0);
+	return updated;
+}
+
+Drawable& EntityStore::drawable(Entity entity)
+{
+	const std::uint32_t i = dense_index(entity);
+	dirty_[i] = 1;
+	return drawables_[i];
+}
+
+void EntityStore::store_previous_transforms()
+{
+	previous_positions_ = world_positions_;
+	previous_rotations_ = world_rotations_;
+}
+
+void EntityStore::query_visible(const Bounds& bounds, std::vector<std::uint32_t>& dense) const
+{
+	PROFILE_ZONE("EntityStore::query_visible");
+	query_ids_.clear();
+	grid_.query(bounds, query_ids_);
+
+	dense.clear();
+	for (std::uint32_t id : query_ids_)
+		dense.push_back(slots_[id].dense);
+	std::sort(dense.begin(), dense.end(), [this](std::uint32_t a, std::uint32_t b) { return draw_orders_[a] < draw_orders_[b]; });
+}
+
+std::size_t EntityStore::memory_bytes() const
+{
+	std::size_t bytes = slots_.capacity() * sizeof(Slot) + (free_slots_.capacity() + query_ids_.capacity()) * sizeof(std::uint32_t)
+		+ ik_owners_.capacity() * sizeof(Entity) + ik_chains_.memory_bytes() + grid_.memory_bytes();
+	for_each_array([&bytes](const auto& values) { bytes += values.capacity() * sizeof(values[0]); });
+	return bytes;
+}
+
+void EntityStore::sync_drawable(std::size_t i, GLfloat alpha)
+{
+	drawables_[i].position = glm::mix(previous_positions_[i], world_positions_[i], alpha);
+	const GLfloat turn = std::remainder(world_rotations_[i] - previous_rotations_[i], glm::two_pi<GLfloat>());
+	drawables_[i].rotation = previous_rotations_[i] + turn * alpha;
+}
+
+void EntityStore::sync_drawables(std::size_t begin, std::size_t end, GLfloat alpha)
+{
+	if (alpha >= 1.0f)
+	{
+		for (std::size_t i = begin; i < end; ++i)
+		{
+			drawables_[i].position = world_positions_[i];
+			drawables_[i].rotation = world_rotations_[i];
+		}
+		return;
+	}
+
+	// Shortest way around, IK angles wrap at +-pi
+	for (std::size_t i = begin; i < end; ++i)
+		sync_drawable(i, alpha);
+}
+
+void EntityStore::sync_drawables(JobSystem& jobs, GLfloat alpha)
+{
+	PROFILE_ZONE("EntityStore::sync_drawables");
+	jobs.parallel_for(size(), sync_batch, [this, alpha](std::size_t begin, std::size_t end)
+	{
+		sync_drawables(begin, end, alpha);
+	});
+}
+
+void EntityStore::sync_drawables(JobSystem& jobs, const std::vector<std::uint32_t>& dense, GLfloat alpha)
+{
+	PROFILE_ZONE("EntityStore::sync_drawables");
+	jobs.parallel_for(dense.size(), sync_batch, [this, &dense, alpha](std::size_t begin, std::size_t end)
+	{
+		for (std::size_t i = begin; i < end; ++i)
+			sync_drawable(dense[i], alpha);
+	});
+}
+
+void EntityStore::add_ik_chain(Entity entity, GLfloat l1, GLfloat l2)
+{
+	Slot& slot = slots_[entity.index];
+	assert(alive(entity) && slot.chain == npos);
+
+	slot.chain = static_cast<std::uint32_t>(ik_owners_.size());
+	ik_owners_.push_back(entity);
+	ik_chains_.resize(ik_owners_.size());
+	ik_chains_.set_leg(slot.chain, l1, l2, { 0, 0 }, { 0, l1 + l2 }, false);
+}
+
+bool EntityStore::has_ik_chain(Entity entity) const
+{
+	return alive(entity) && slots_[entity.index].chain != npos;
+}
+
+void EntityStore::set_ik_target(Entity entity, glm::vec2 base, glm::vec2 target, bool flip_direction)
+{
+	assert(has_ik_chain(entity));
+	const std::uint32_t i = slots_[entity.index].chain;
+	ik_chains_.set_leg(i, ik_chains_.l1[i], ik_chains_.l2[i], base, target, flip_direction);
+}
+
+IKChainState EntityStore::ik_chain(Entity entity) const
+{
+	assert(has_ik_chain(entity));
+	const std::uint32_t i = slots_[entity.index].chain;
+	return { ik_chains_.first(i), ik_chains_.second(i), ik_chains_.last(i), ik_chains_.angle1[i], ik_chains_.angle2[i] };
+}
+
+void EntityStore::solve_ik_chains(JobSystem& jobs)
+{
+	PROFILE_ZONE("EntityStore::solve_ik_chains");
+	const IKBatchInput in = ik_chains_.input();
+	const IKBatchOutput out = ik_chains_.output();
+
+	jobs.parallel_for(in.count, ik_batch, [&](std::size_t begin, std::size_t end)
+	{
+		PROFILE_ZONE("IKSolverBatch::solve");
+		const IKBatchInput range_in = { in.base_x + begin, in.base_y + begin, in.target_x + begin, in.target_y + begin,
+		                                in.l1 + begin, in.l2 + begin, in.flip_direction + begin, end - begin };
+		const IKBatchOutput range_out = { out.first_x + begin, out.first_y + begin, out.second_x + begin, out.second_y + begin,
+		                                  out.last_x + begin, out.last_y + begin, out.angle1 + begin, out.angle2 + begin };
+		IKSolverBatch::solve(range_in, range_out);
+	});
+}
+
+void EntityStore::remove_ik_chain(std::uint32_t chain)
+{
+	slots_[ik_owners_.back().index].chain = chain;
+	move_last_into(ik_owners_, chain);
+
+	for (auto* values : { &ik_chains_.base_x, &ik_chains_.base_y, &ik_chains_.target_x, &ik_chains_.target_y,
+	                      &ik_chains_.l1, &ik_chains_.l2, &ik_chains_.first_x, &ik_chains_.first_y,
+	                      &ik_chains_.second_x, &ik_chains_.second_y, &ik_chains_.last_x, &ik_chains_.last_y,
+	                      &ik_chains_.angle1, &ik_chains_.angle2 })
+		move_last_into(*values, chain);
+	move_last_into(ik_chains_.flip_direction, chain);
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "IKSolverBatch.h"
+#include "SpatialGrid.h"
+#include "rect.h"
+
+class JobSystem;
+
+// Generational handle. A destroyed entity's slot is reused with a new generation,
+// so stale handles are detected instead of aliasing the new owner.
+struct Entity
+{
+	static constexpr std::uint32_t invalid = 0xffffffffu;
+
+	std::uint32_t index = invalid;
+	std::uint32_t generation = 0;
+
+	bool operator==(const Entity& other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(const Entity& other) const { return !(*this == other); }
+};
+
+// Local transform of one entity, references into the store's arrays.
+// Only valid until the next create(), destroy(), set_parent() or update_world_transforms().
+struct TransformRef
+{
+	glm::vec2& position;
+	GLfloat& rotation;
+	GLfloat& scale;
+};
+
+struct Transform
+{
+	glm::vec2 position = { 0,0 };
+	GLfloat rotation = 0.0f;
+	GLfloat scale = 1.0f;
+};
+
+// Result of an IK chain component after the last solve_ik_chains()
+struct IKChainState
+{
+	glm::vec2 first{ 0.0f }, second{ 0.0f }, last{ 0.0f };
+	GLfloat angle1 = 0.0f, angle2 = 0.0f;
+};
+
+// Entities and their components in dense structure-of-arrays storage. Component i of
+// every array belongs to entities()[i]; destroying an entity moves the last one into its place.
+// IK chains are an optional component with their own dense arrays, solved in one batch.
+//
+// Transforms are local to the parent entity. The dense arrays are kept sorted so parents come
+// before their children, which lets update_world_transforms() resolve the whole hierarchy in one
+// linear pass, recomputing only entities whose local transform or an ancestor's changed.
+// The same pass refreshes each recomputed entity's drawable bounds in a SpatialGrid.
+class EntityStore
+{
+public:
+	Entity create();
+	void destroy(Entity entity);
+	bool alive(Entity entity) const;
+
+	std::size_t size() const { return entities_.size(); }
+	void reserve(std::size_t count);
+
+	// Local transform, marks the entity dirty
+	TransformRef transform(Entity entity);
+	// As of the last update_world_transforms()
+	Transform world_transform(Entity entity) const;
+	// Marks the entity dirty so size or origin changes reach the spatial index
+	Drawable& drawable(Entity entity);
+
+	// Parent an entity, an invalid parent makes it a root. The local transform is kept, so
+	// the entity moves with its new parent. Returns false if that would create a cycle.
+	bool set_parent(Entity child, Entity parent);
+	Entity parent(Entity entity) const;
+
+	// Dense arrays for systems. Writes to the local transforms or drawables need mark_dirty().
+	const std::vector<Entity>& entities() const { return entities_; }
+	std::vector<glm::vec2>& positions() { return positions_; }
+	std::vector<GLfloat>& rotations() { return rotations_; }
+	std::vector<GLfloat>& scales() { return scales_; }
+	std::vector<Drawable>& drawables() { return drawables_; }
+	void mark_dirty(std::size_t dense) { dirty_[dense] = 1; }
+	void mark_all_dirty();
+
+	// Recomputes world transforms of dirty entities and their descendants.
+	// Returns how many were recomputed.
+	std::size_t update_world_transforms();
+
+	// Dense indices of entities whose drawable overlaps bounds as of the last
+	// update_world_transforms(), in draw order: the order the entities were created in, which
+	// the dense arrays do not keep. Replaces the contents of dense.
+	void query_visible(const Bounds& bounds, std::vector<std::uint32_t>& dense) const;
+	const SpatialGrid& spatial_grid() const { return grid_; }
+
+	// Heap bytes held by every array, the slot table, IK chains and the spatial grid, spare
+	// capacity included
+	std::size_t memory_bytes() const;
+
+	// Remembers the current world transforms, call at the start of every simulation tick
+	void store_previous_transforms();
+
+	// Copies world transforms into drawables for [begin, end) of the dense arrays, blended
+	// from the previous tick by alpha in [0, 1]. 1 uses the current transforms as is.
+	void sync_drawables(std::size_t begin, std::size_t end, GLfloat alpha = 1.0f);
+	void sync_drawables(JobSystem& jobs, GLfloat alpha = 1.0f);
+	// Only the listed dense indices, e.g. the result of query_visible()
+	void sync_drawables(JobSystem& jobs, const std::vector<std::uint32_t>& dense, GLfloat alpha = 1.0f);
+
+	// Two bone IK chain component
+	void add_ik_chain(Entity entity, GLfloat l1, GLfloat l2);
+	bool has_ik_chain(Entity entity) const;
+	void set_ik_target(Entity entity, glm::vec2 base, glm::vec2 target, bool flip_direction);
+	IKChainState ik_chain(Entity entity) const;
+
+	// Solves every IK chain, split over the job system once there are enough of them
+	void solve_ik_chains(JobSystem& jobs);
+	std::size_t ik_chain_count() const { return ik_chains_.size(); }
+
+private:
+	static constexpr std::uint32_t npos = 0xffffffffu;
+
+	struct Slot
+	{
+		std::uint32_t generation = 0;
+		std::uint32_t dense = npos;
+		std::uint32_t chain = npos;
+	};
+
+	std::uint32_t dense_index(Entity entity) const;
+	std::uint32_t parent_dense(std::size_t dense) const;
+	void remove_ik_chain(std::uint32_t chain);
+	void sync_drawable(std::size_t dense, GLfloat alpha);
+	void sort_by_depth();
+	// Refreshes parent_indices_, false if a parent comes after its child
+	bool link_parents();
+
+	// Calls fn on every dense per entity array
+	template <typename Fn>
+	void for_each_array(Fn&& fn)
+	{
+		fn(entities_); fn(parents_); fn(parent_indices_); fn(child_counts_); fn(dirty_);
+		fn(positions_); fn(rotations_); fn(scales_); fn(drawables_);
+		fn(world_positions_); fn(world_rotations_); fn(world_scales_);
+		fn(previous_positions_); fn(previous_rotations_); fn(placed_); fn(draw_orders_);
+	}
+	template <typename Fn>
+	void for_each_array(Fn&& fn) const
+	{
+		fn(entities_); fn(parents_); fn(parent_indices_); fn(child_counts_); fn(dirty_);
+		fn(positions_); fn(rotations_); fn(scales_); fn(drawables_);
+		fn(world_positions_); fn(world_rotations_); fn(world_scales_);
+		fn(previous_positions_); fn(previous_rotations_); fn(placed_); fn(draw_orders_);
+	}
+
+	std::vector<Slot> slots_;
+	std::vector<std::uint32_t> free_slots_;
+
+	// Dense components, indexed by Slot::dense
+	std::vector<Entity> entities_;
+	std::vector<Entity> parents_;
+	std::vector<std::uint32_t> parent_indices_;
+	std::vector<std::uint32_t> child_counts_;
+	std::vector<std::uint8_t> dirty_;
+	std::vector<glm::vec2> positions_;
+	std::vector<GLfloat> rotations_;
+	std::vector<GLfloat> scales_;
+	std::vector<Drawable> drawables_;
+
+	// World transforms cached by update_world_transforms
+	std::vector<glm::vec2> world_positions_;
+	std::vector<GLfloat> world_rotations_;
+	std::vector<GLfloat> world_scales_;
+
+	// Drawable bounds by entity index, refreshed for recomputed entities
+	SpatialGrid grid_;
+	mutable std::vector<std::uint32_t> query_ids_;
+
+	// parent_indices_ are stale and the depth order may be broken
+	bool hierarchy_changed_ = false;
+
+	// World transforms at the start of the current tick, for render interpolation
+	std::vector<glm::vec2> previous_positions_;
+	std::vector<GLfloat> previous_rotations_;
+	// 0 until update_world_transforms() first computes the entity, which then starts its
+	// previous transform there instead of blending in from the origin
+	std::vector<std::uint8_t> placed_;
+
+	// Creation sequence, later entities paint over earlier ones whatever their dense index
+	std::vector<std::uint64_t> draw_orders_;
+	std::uint64_t next_draw_order_ = 0;
+
+	// Dense IK chains, indexed by Slot::chain
+	IKSolverBatch ik_chains_;
+	std::vector<Entity> ik_owners_;
+};
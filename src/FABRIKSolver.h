@@ -0,0 +1,153 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+// Forward And Backward Reaching IK (Aristidou & Lasenby) for chains of any length.
+// joints[0] is the base and joints.back() the end effector, segment i connects joints[i] and joints[i + 1].
+// Storage is sized by set_chain, solve works in place and never allocates.
+class FABRIKSolver
+{
+public:
+	std::vector<glm::vec2> joints;
+	std::vector<GLfloat> lengths;
+
+	// Bend limits per joint in radians, {min, max} of segment i relative to segment i - 1.
+	// Segment 0 is measured against base_direction.
+	std::vector<glm::vec2> limits;
+	glm::vec2 base_direction = { 1.0f, 0.0f };
+
+	GLuint max_iterations = 10;
+	GLfloat tolerance = 0.5f;
+
+	// Iterations spent by the last solve
+	GLuint iterations = 0;
+
+private:
+	GLfloat reach_ = 0.0f;
+	bool limited_ = false;
+
+public:
+	void set_chain(const glm::vec2 base, const std::vector<GLfloat>& segment_lengths)
+	{
+		lengths = segment_lengths;
+		joints.resize(lengths.size() + 1);
+		limits.assign(lengths.size(), { -glm::pi<GLfloat>(), glm::pi<GLfloat>() });
+		limited_ = false;
+
+		// Start out straight along the base direction
+		reach_ = 0.0f;
+		joints[0] = base;
+		for (size_t i = 0; i < lengths.size(); ++i)
+		{
+			joints[i + 1] = joints[i] + base_direction * lengths[i];
+			reach_ += lengths[i];
+		}
+	}
+
+	void set_limit(size_t joint, GLfloat min_angle, GLfloat max_angle)
+	{
+		limits[joint] = { min_angle, max_angle };
+		limited_ = true;
+	}
+
+	// Returns true when the end effector ended up within tolerance of the target
+	bool solve(const glm::vec2 base, const glm::vec2 target)
+	{
+		iterations = 0;
+		if (lengths.empty())
+			return false;
+
+		const size_t n = lengths.size();
+
+		// Out of reach, lay the chain straight towards the target
+		if (glm::distance(base, target) >= reach_)
+		{
+			const glm::vec2 direction = safe_normalize(target - base, base_direction);
+			joints[0] = base;
+			for (size_t i = 0; i < n; ++i)
+				joints[i + 1] = joints[i] + direction * lengths[i];
+
+			if (limited_)
+				forward(base);
+			return false;
+		}
+
+		const GLfloat tolerance_squared = tolerance * tolerance;
+		while (iterations < max_iterations)
+		{
+			const glm::vec2 error = joints[n] - target;
+			if (glm::dot(error, error) <= tolerance_squared && joints[0] == base)
+				return true;
+
+			backward(target);
+			forward(base);
+			++iterations;
+		}
+
+		const glm::vec2 error = joints[n] - target;
+		return glm::dot(error, error) <= tolerance_squared;
+	}
+
+	// World angle of a segment, the equivalent of IKSolver::angle1 for segment 0
+	GLfloat segment_angle(size_t segment) const
+	{
+		const glm::vec2 d = joints[segment + 1] - joints[segment];
+		return std::atan2(d.y, d.x);
+	}
+
+private:
+	// End effector to base, pinning the last joint on the target
+	void backward(const glm::vec2 target)
+	{
+		const size_t n = lengths.size();
+		joints[n] = target;
+		for (size_t i = n; i-- > 0;)
+		{
+			const glm::vec2 direction = safe_normalize(joints[i] - joints[i + 1], -base_direction);
+			joints[i] = joints[i + 1] + direction * lengths[i];
+		}
+	}
+
+	// Base to end effector, pinning the base and applying bend limits
+	void forward(const glm::vec2 base)
+	{
+		joints[0] = base;
+		glm::vec2 parent = base_direction;
+		for (size_t i = 0; i < lengths.size(); ++i)
+		{
+			glm::vec2 direction = safe_normalize(joints[i + 1] - joints[i], parent);
+			if (limited_)
+				direction = constrain(parent, direction, limits[i]);
+
+			joints[i + 1] = joints[i] + direction * lengths[i];
+			parent = direction;
+		}
+	}
+
+	// Clamp the signed angle between two unit vectors
+	static glm::vec2 constrain(const glm::vec2 parent, const glm::vec2 direction, const glm::vec2 limit)
+	{
+		const GLfloat cross = parent.x * direction.y - parent.y * direction.x;
+		const GLfloat angle = std::atan2(cross, glm::dot(parent, direction));
+		if (angle >= limit.x && angle <= limit.y)
+			return direction;
+
+		const GLfloat clamped = glm::clamp(angle, limit.x, limit.y);
+		const GLfloat s = std::sin(clamped);
+		const GLfloat c = std::cos(clamped);
+		return { parent.x * c - parent.y * s, parent.x * s + parent.y * c };
+	}
+
+	static glm::vec2 safe_normalize(const glm::vec2 v, const glm::vec2 fallback)
+	{
+		const GLfloat length_squared = glm::dot(v, v);
+		if (length_squared < 1e-12f)
+			return fallback;
+		return v / std::sqrt(length_squared);
+	}
+};
@@ -0,0 +1,129 @@
+#include "GLProfiler.h"
+
+#include <iostream>
+
+namespace
+{
+	constexpr std::size_t no_pass = static_cast<std::size_t>(-1);
+}
+
+GLProfiler::GLProfiler()
+	: active_pass_(no_pass)
+{
+}
+
+GLProfiler::~GLProfiler()
+{
+	for (auto& set : queries_)
+		for (auto& query : set)
+			glDeleteQueries(1, &query.id);
+}
+
+std::size_t GLProfiler::add_pass(const std::string& name)
+{
+	for (auto& set : queries_)
+	{
+		set.emplace_back();
+		glGenQueries(1, &set.back().id);
+	}
+	names_.push_back(name);
+	last_.pass_ms.push_back(-1.0);
+	return names_.size() - 1;
+}
+
+void GLProfiler::begin_pass(std::size_t pass)
+{
+	if (active_pass_ != no_pass)
+		end_pass();
+
+	Query& query = queries_[frame_ % frames_in_flight][pass];
+	glBeginQuery(GL_TIME_ELAPSED, query.id);
+	query.issued = true;
+	active_pass_ = pass;
+}
+
+void GLProfiler::end_pass()
+{
+	if (active_pass_ == no_pass)
+		return;
+
+	glEndQuery(GL_TIME_ELAPSED);
+	active_pass_ = no_pass;
+}
+
+void GLProfiler::end_frame()
+{
+	end_pass();
+
+	last_.frame = frame_;
+	last_.calls = GLState::last_frame();
+
+	// Oldest set in flight, it is rewritten next frame
+	last_.gpu_ms = 0.0;
+	auto& oldest = queries_[(frame_ + 1) % frames_in_flight];
+	for (std::size_t pass = 0; pass < oldest.size(); ++pass)
+	{
+		Query& query = oldest[pass];
+		if (!query.issued)
+			continue;
+
+		GLuint available = 0;
+		glGetQueryObjectuiv(query.id, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			continue;
+
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(query.id, GL_QUERY_RESULT, &nanoseconds);
+		query.issued = false;
+
+		last_.pass_ms[pass] = nanoseconds * 1e-6;
+	}
+	for (double ms : last_.pass_ms)
+		if (ms > 0.0)
+			last_.gpu_ms += ms;
+
+	if (csv_.is_open())
+	{
+		const GLStateStats& c = last_.calls;
+		csv_ << last_.frame << "," << c.draw_calls << "," << c.instances << "," << c.state_changes << ","
+			<< c.program_binds << "," << c.program_binds_elided << "," << c.texture_binds << "," << c.texture_binds_elided << ","
+			<< c.uniform_uploads << "," << c.uniform_uploads_elided << "," << c.buffer_uploads << "," << c.buffer_bytes << ","
+			<< c.sprites_visible << "," << c.sprites_culled << "," << last_.gpu_ms;
+		for (double ms : last_.pass_ms)
+			csv_ << "," << ms;
+		csv_ << "\n";
+	}
+
+	++frame_;
+}
+
+bool GLProfiler::open_csv(const std::string& file_name)
+{
+	csv_.open(file_name);
+	if (!csv_)
+	{
+		std::cerr << "Failed to open GL stats file: " << file_name << std::endl;
+		return false;
+	}
+
+	csv_ << "frame,draw_calls,instances,state_changes,program_binds,program_binds_elided,texture_binds,"
+		"texture_binds_elided,uniform_uploads,uniform_uploads_elided,buffer_uploads,buffer_bytes,sprites_visible,sprites_culled,gpu_ms";
+	for (const auto& name : names_)
+		csv_ << "," << name << "_ms";
+	csv_ << "\n";
+	return true;
+}
+
+void GLProfiler::log(std::ostream& out) const
+{
+	const GLStateStats& c = last_.calls;
+	out << "frame " << last_.frame << ": " << c.draw_calls << " draws (" << c.instances << " instances), "
+		<< c.state_changes << " state changes, programs " << c.program_binds << " (+" << c.program_binds_elided << " elided), "
+		<< "textures " << c.texture_binds << " (+" << c.texture_binds_elided << " elided), "
+		<< "uniforms " << c.uniform_uploads << " (+" << c.uniform_uploads_elided << " elided), "
+		<< c.buffer_bytes << " bytes in " << c.buffer_uploads << " uploads, "
+		<< c.sprites_visible << " sprites visible (" << c.sprites_culled << " culled), gpu " << last_.gpu_ms << " ms";
+	for (std::size_t pass = 0; pass < names_.size(); ++pass)
+		out << ", " << names_[pass] << " " << last_.pass_ms[pass] << " ms";
+	out << "\n";
+}
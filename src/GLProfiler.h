@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+
+#include "gl_state.h"
+
+// Everything measured for one frame
+struct GLFrameStats
+{
+	std::uint64_t frame = 0;
+	GLStateStats calls;
+
+	// GPU milliseconds per pass, in add_pass order, -1 while no result is in yet.
+	// These trail `calls` by GLProfiler::frames_in_flight - 1 frames.
+	std::vector<double> pass_ms;
+	double gpu_ms = 0.0;
+};
+
+// GPU pass timing through GL_TIME_ELAPSED queries, plus the GLState call counters.
+// Each frame writes its queries into one of frames_in_flight sets and reads back the
+// set written frames_in_flight - 1 frames earlier, so reading results never stalls.
+// Time elapsed queries can't nest, passes must not overlap.
+class GLProfiler
+{
+public:
+	static constexpr unsigned frames_in_flight = 3;
+
+	GLProfiler();
+	~GLProfiler();
+
+	GLProfiler(const GLProfiler&) = delete;
+	GLProfiler& operator=(const GLProfiler&) = delete;
+
+	// Register passes up front, the returned index names the pass
+	std::size_t add_pass(const std::string& name);
+	const std::vector<std::string>& pass_names() const { return names_; }
+
+	void begin_pass(std::size_t pass);
+	void end_pass();
+
+	// Call once per frame, after GLState::end_frame
+	void end_frame();
+	const GLFrameStats& last_frame() const { return last_; }
+
+	// Appends one row per frame from now on
+	bool open_csv(const std::string& file_name);
+
+	void log(std::ostream& out) const;
+
+private:
+	struct Query
+	{
+		GLuint id = 0;
+		bool issued = false;
+	};
+
+	// queries_[frame set][pass]
+	std::vector<Query> queries_[frames_in_flight];
+	std::vector<std::string> names_;
+	std::size_t active_pass_;
+	std::uint64_t frame_ = 0;
+
+	GLFrameStats last_;
+	std::ofstream csv_;
+};
@@ -1,11 +1,15 @@
 #pragma once
 
+#include <cmath>
 #include <memory>
+#include <vector>
 #include <glad/glad.h>
 
+#include "Crowd.h"
 #include "Engine.h"
 #include "Keyboard.h"
-#include "IKSolver.h"
+#include "Profiler.h"
+#include "Terrain.h"
 
 struct Game
 {
@@ -21,372 +25,256 @@ struct Prototype : Game
 {
 	std::unique_ptr<Engine> engine;
 
-	Prototype(GLuint width, GLuint height)
+	Prototype(GLuint width, GLuint height, EngineConfig config = {})
 	{
-		engine = std::make_unique<Engine>(width, height);
+		engine = std::make_unique<Engine>(width, height, config);
 		engine->init();
 	}
 	~Prototype() override = default;
 
 	void run() override
 	{
-		while (engine->window->is_open())
+		while (engine->is_running())
 		{
-			engine->handle_input();
-			update(engine->delta_time);
-			engine->update();
-			engine->render();
-		}
-	}
-
-	// Joints and body parts
-	std::shared_ptr<GameObject> r1, r2, r3, l1, l2, l3, r_upper, r_lower, l_upper, l_lower, body, head, eye1, eye2;
+			{
+				PROFILE_ZONE("Engine::handle_input");
+				engine->handle_input();
+			}
 
-	std::shared_ptr<IKSolver> leg_r, leg_l;
+			// Fixed ticks, as many as real time asks for since the last frame
+			for (unsigned ticks = engine->advance_frame(); ticks > 0; --ticks)
+			{
+				PROFILE_ZONE("tick");
+				engine->begin_tick();
+				{
+					PROFILE_ZONE("Prototype::update");
+					update(engine->delta_time);
+				}
+				{
+					PROFILE_ZONE("Engine::update");
+					engine->update();
+				}
+			}
 
-	glm::vec2 root, r_base, l_base;
-	glm::vec2 lerp_position_r = { 0,length * 2 };
-	glm::vec2 lerp_position_l = { 0,length * 2 };
-	glm::vec2 cur_pos_r = { 0,length * 2 };
-	glm::vec2 cur_pos_l = { 0,length * 2 };
+			{
+				PROFILE_ZONE("Engine::render");
+				engine->render();
+			}
+			engine->end_frame();
+		}
+	}
 
+	// The player is walker 0 of the crowd, the other crowd_size walkers pace on their own.
+	// The crowd solves the legs and the game objects only show them.
+	std::unique_ptr<Crowd> crowd;
+	std::size_t player = 0;
+	std::size_t crowd_size = 0;
+	unsigned leg_count = 2;
+	Gait gait = Gait::tripod;
 	GLfloat length = 200.0f;
-	GLfloat step_size = 200.0f;
-	GLfloat step_distance = 200.0f;
-	GLfloat step_speed = 20.0f;
+	// Rolling ground under every row of walkers, or the flat floor they started on
+	bool flat_ground = false;
+	Terrain terrain;
 
-
-	glm::vec2 step_target_position = { 0,0 };
-	glm::vec2 pivot_centre_r{ 0,0 };
-	glm::vec2 pivot_centre_l{ 0,0 };
-	glm::vec2 step_start{ 0,0 };
-
-	bool moving_right = true;
-	bool r_step = false;
-	bool l_step = false;
-	
+	// Game objects drawing one walker
+	struct LegParts
+	{
+		std::shared_ptr<GameObject> hip, upper, knee, foot, lower;
+	};
+	struct WalkerParts
+	{
+		std::shared_ptr<GameObject> body, head, eye1, eye2;
+		std::vector<LegParts> legs;
+	};
+	std::vector<WalkerParts> walkers;
 
 	void start() override
 	{
-		// Leg IK
-		leg_r = std::make_shared<IKSolver>();
-		leg_l = std::make_shared<IKSolver>();
-
-		// Right Leg
-		r1 = engine->add_game_object();
-		r2 = engine->add_game_object();
-		r3 = engine->add_game_object();
-		r_upper = engine->add_game_object();
-		r_lower = engine->add_game_object();
-
-		// Left Leg
-		l1 = engine->add_game_object();
-		l2 = engine->add_game_object();
-		l3 = engine->add_game_object();
-		l_upper = engine->add_game_object();
-		l_lower = engine->add_game_object();
-
-
-		body = engine->add_game_object();
-		head = engine->add_game_object();
-		eye1 = engine->add_game_object();
-		eye2 = engine->add_game_object();
-
-
-
-		// Creates drawables
-		for (auto go : engine->objects)
+		const WalkerDesc desc = WalkerDesc::make(leg_count, length, 0.0f, gait);
+		crowd = std::make_unique<Crowd>(desc);
+		// Half the head's width, it is three default sprites wide
+		crowd->head_lead = Drawable().size.x * 3 / 2;
+		if (!flat_ground)
 		{
-			auto circ = std::make_shared<struct Drawable>();
-			circ->material = engine->circ_mat;
-			circ->material->color = { 1,0.5,0 };
-			go->drawable = *circ;
+			add_terrain(1 + (crowd_size + 99) / 100);
+			crowd->set_terrain(&terrain);
 		}
+		player = crowd->add({ 0, 20 }, length * 2, false);
 
-		// Head
+		// The crowd stands in rows of 100 behind the player
+		for (std::size_t i = 0; i < crowd_size; ++i)
 		{
-			auto quad = std::make_shared<struct Drawable>();
-			quad->material = engine->quad_mat;
-			quad->transform_origin = Drawable::centered;
-			quad->size *= 3;
-
-			head->drawable = *quad;
+			const GLfloat row = static_cast<GLfloat>(i / 100 + 1) * length * 3;
+			const GLfloat x = (static_cast<GLfloat>(i % 100) - 50.0f) * length * 1.5f;
+			crowd->add({ x, 20 + row }, length * 2 + row, true);
 		}
 
-		// Body
-		{
-			auto quad = std::make_shared<struct Drawable>();
-			quad->material = engine->quad_mat;
-			quad->material->color = { 1,0.5,0 };
-			quad->transform_origin = Drawable::bottom_middle;
-			quad->size.y *= 4;
-
-			body->drawable = *quad;
-		}
-
-
-		// Limb segments
-		{
-			auto quad = std::make_shared<struct Drawable>();
-			quad->material = engine->quad_mat;
-			quad->transform_origin = Drawable::center_left;
-			quad->size.x = length;
-			quad->size.y *= 0.7f;
-
-			r_upper->drawable = *quad;
-		}
-		{
-			auto quad = std::make_shared<struct Drawable>();
-			quad->material = engine->quad_mat;
-			quad->transform_origin = Drawable::center_left;
-			quad->size.x = length;
-			quad->size.y *= 0.7f;
-
-			r_lower->drawable = *quad;
-		}
-
-		{
-			auto quad = std::make_shared<struct Drawable>();
-			quad->material = engine->quad_mat;
-			quad->transform_origin = Drawable::center_left;
-			quad->size.x = length;
-			quad->size.y *= 0.7f;
-
-			l_upper->drawable = *quad;
-		}
-		{
-			auto quad = std::make_shared<struct Drawable>();
-			quad->material = engine->quad_mat;
-			quad->transform_origin = Drawable::center_left;
-			quad->size.x = length;
-			quad->size.y *= 0.7f;
-
-			l_lower->drawable = *quad;
-		}
-
-
-
-		// eyes
-		{
-			eye1->drawable.size *= 0.5f;
-			eye1->drawable.material = engine->circ_mat2;
-			eye1->drawable.material->color = { 0.1f,0.0f,0.1f };
-
-			eye2->drawable.size *= 0.5f;
-			eye2->drawable.material = engine->circ_mat2;
-		}
-
-
-		root = { 0,20 };
-
-
-		// Starting positions
-		leg_r->solve(length, length, { 0,0 }, { 0 , length * 2 }, 0);
-		leg_l->solve(length, length, { 0,0 }, { 0 , length * 2 }, 0);
-
-		r_base = leg_r->first;
-		l_base = leg_l->first;
-
-		step_target_position = { 0 , length * 2 };
-		step_target_position.x += 50;
-
-		lerp_position_r = leg_r->last;
-		lerp_position_l = leg_l->last;
-
-		pivot_centre_r.y = length * 2;
-		pivot_centre_l.y = length * 2;
-
+		walkers.resize(crowd->size());
+		for (WalkerParts& walker : walkers)
+			add_walker(walker, desc);
 
+		engine->snapshot = [this](std::vector<GLfloat>& state) { crowd->snapshot(state); };
 
+		update_visuals();
 	}
 
-	glm::vec2 rotated{ 0,0 };
-
-	glm::vec2 eye_offset = { 40, 0 };
-	glm::vec2 head_offset = { 0, -100};
-
-	GLfloat blink = 0;
 	void update(GLfloat dt) override
 	{
 		glm::vec2 direction = { 0,0 };
 		if (Keyboard::key(GLFW_KEY_RIGHT))
-		{
 			direction.x = 1;
-			moving_right = true;
-		}
 		if (Keyboard::key(GLFW_KEY_LEFT))
-		{
 			direction.x = -1;
-			moving_right = false;
-		}
 		if (Keyboard::key(GLFW_KEY_UP))
-		{
 			direction.y = -1;
-		}
 		if (Keyboard::key(GLFW_KEY_DOWN))
-		{
 			direction.y = 1;
-		}
 
+		// Walking, heads and eyes follow
+		crowd->set_direction(player, direction);
+		crowd->update(dt, engine->jobs.get());
+
+		update_visuals();
+	}
 
-		// Positioning R foot
-		if (Keyboard::key(GLFW_KEY_Q))
-			lerp_position_r.x -= 1;
-		if (Keyboard::key(GLFW_KEY_W))
-			lerp_position_r.x += 1;
-		// Position R base
-		if (Keyboard::key(GLFW_KEY_E))
-			r_base.x -= 1;
-		if (Keyboard::key(GLFW_KEY_R))
-			r_base.x += 1;
-
-		// Positioning L foot
-		if (Keyboard::key(GLFW_KEY_A))
-			lerp_position_l.x -= 1;
-		if (Keyboard::key(GLFW_KEY_S))
-			lerp_position_l.x += 1;
-		// Position R base
-		if (Keyboard::key(GLFW_KEY_D))
-			l_base.x -= 1;
-		if (Keyboard::key(GLFW_KEY_F))
-			l_base.x += 1;
-
-
-
-		// Base movement
-		// -------------
-		root += direction * 10.0f;
-		if (moving_right)
-			step_target_position.x = root.x + step_size;
-		else
-			step_target_position.x = root.x - step_size;
-
-		// Leg root following parent root
-		r_base += root;
-		l_base += root;
-		
-
-		// Walking
-		// -------
-		if (direction.x != 0)
+	void add_walker(WalkerParts& walker, const WalkerDesc& desc)
+	{
+		// Legs
+		walker.legs.resize(desc.legs.size());
+		for (LegParts& leg : walker.legs)
 		{
-			if (check_step(root, leg_r->last))
-				r_step = true;
-			if (check_step(root, leg_l->last))
-				l_step = true;
+			leg.hip = engine->add_game_object();
+			leg.knee = engine->add_game_object();
+			leg.foot = engine->add_game_object();
+			leg.upper = engine->add_game_object();
+			leg.lower = engine->add_game_object();
 		}
 
-		do_step_lifted(r_step, lerp_position_r, dt);
-		do_step_lifted(l_step, lerp_position_l, dt);
-
-		cur_pos_r = lerp(cur_pos_r, lerp_position_r, dt * step_speed);
-		cur_pos_l = lerp(cur_pos_l, lerp_position_l, dt * step_speed);
-
-		leg_r->solve(length, length, root, cur_pos_r, moving_right);
-		leg_l->solve(length, length, root, cur_pos_l, moving_right);
-
-		// Update visual
-		// -------------
-		body->transform.position = root;
-		head->transform.position = body->transform.position;
-
-
-		r1->transform.position = leg_r->first;
-		r2->transform.position = leg_r->second;
-		r3->transform.position = leg_r->last;
-
-		l1->transform.position = leg_l->first;
-		l2->transform.position = leg_l->second;
-		l3->transform.position = leg_l->last;
-
-		// Limbs visual
-		r_upper->transform.position = leg_r->first;
-		r_upper->transform.rotation = leg_r->angle1;
-		r_lower->transform.position = leg_r->last;
-		r_lower->transform.rotation = leg_r->angle1 + leg_r->angle2;
-
-
-		l_upper->transform.position = leg_l->first;
-		l_upper->transform.rotation = leg_l->angle1;
-		l_lower->transform.position = leg_l->last;
-		l_lower->transform.rotation = leg_l->angle1 + leg_l->angle2;
-		/*
-		l_upper->transform.position = leg_l->first;
-		l_lower->transform.position = leg_l->second;
-		update_limb_visual(*l_upper, leg_l->second);
-		update_limb_visual(*l_lower, leg_l->last);
-		*/
+		walker.body = engine->add_game_object();
+		walker.head = engine->add_game_object();
+		walker.eye1 = engine->add_game_object();
+		walker.eye2 = engine->add_game_object();
 
-		/*
-		pivot_centre_r.x = (step_target_position.x - leg_r->last.x) * 0.5f + leg_r->last.x;
-		pivot_centre_l.x = (step_target_position.x - leg_l->last.x) * 0.5f + leg_l->last.x;
-		*/
+		// Joints
+		for (LegParts& leg : walker.legs)
+			for (auto joint : { leg.hip, leg.knee, leg.foot })
+				joint->drawable().material = engine->circ_mat;
+		engine->circ_mat->color = { 1,0.5,0 };
 
-		// head bla
-		head->transform.position.y = root.y - 200;
-		head->transform.position.x = ease_lerp(head->transform.position.x, root.x + (head->drawable.size.x / 2 * direction.x), dt * 20.0f);
+		for (std::size_t i = 0; i < walker.legs.size(); ++i)
+			attach_leg(walker, walker.legs[i], desc.legs[i]);
 
-		eye1->transform.position.y = head->transform.position.y;
-		eye2->transform.position.y = head->transform.position.y;
+		// Head
+		{
+			auto& quad = walker.head->drawable();
+			quad.material = engine->quad_mat;
+			quad.transform_origin = Drawable::centered;
+			quad.size *= 3;
+		}
 
-		eye1->transform.position = ease_lerp(eye1->transform.position, head->transform.position + eye_offset, dt * 20.0f) + direction;
-		eye2->transform.position = ease_lerp(eye2->transform.position, head->transform.position - eye_offset, dt * 20.0f);
+		// Body
+		{
+			auto& quad = walker.body->drawable();
+			quad.material = engine->quad_mat;
+			quad.material->color = { 1,0.5,0 };
+			quad.transform_origin = Drawable::bottom_middle;
+			quad.size.y *= 4;
+		}
 
+		// Limb segments
+		for (LegParts& leg : walker.legs)
+		{
+			for (auto limb : { leg.upper, leg.lower })
+			{
+				auto& quad = limb->drawable();
+				quad.material = engine->quad_mat;
+				quad.transform_origin = Drawable::center_left;
+				quad.size.x = length;
+				quad.size.y *= 0.7f;
+			}
+		}
 
-	}
-	bool check_step(const glm::vec2 base_pos, const glm::vec2 lerp_pos)
-	{
-		GLfloat distance = glm::distance(base_pos, lerp_pos);
-		return distance > length * 2;
-	}
+		// eyes
+		{
+			walker.eye1->drawable().size *= 0.5f;
+			walker.eye1->drawable().material = engine->circ_mat2;
+			walker.eye1->drawable().material->color = { 0.1f,0.0f,0.1f };
 
-	void do_step_simple(glm::vec2& lerp_pos)
-	{
-		lerp_pos = step_target_position;
+			walker.eye2->drawable().size *= 0.5f;
+			walker.eye2->drawable().material = engine->circ_mat2;
+		}
 	}
 
-	GLfloat elapsed = 0.0f;
-	GLfloat step_heigth = 40;
-	GLfloat circ_step_speed = 0.5f;
-
-	void do_step_lifted(bool& step, glm::vec2& lerp_pos, GLfloat dt)
+	// Hills under each row of walkers, wide enough for the crowd to pace on
+	void add_terrain(std::size_t rows)
 	{
-		if (!step) return;
-
-		elapsed += dt;
-		GLfloat t = elapsed / circ_step_speed;
-		if (t < 1)
+		const GLfloat spacing = 100.0f;
+		const std::size_t samples = 401;
+		const GLfloat x0 = -spacing * (samples - 1) / 2;
+		std::vector<GLfloat> heights(samples);
+		for (std::size_t row = 0; row < rows; ++row)
 		{
-			lerp_pos = lerp(lerp_pos, step_target_position, t);
-			lerp_pos.y -= sin(t * glm::pi<GLfloat>()) * step_heigth;
+			const GLfloat ground = length * 2 + row * length * 3;
+			for (std::size_t i = 0; i < samples; ++i)
+			{
+				const GLfloat x = x0 + i * spacing;
+				heights[i] = ground + 60.0f * std::sin(x / 500.0f) + 25.0f * std::sin(x / 170.0f + row);
+			}
+			terrain.add_heightfield(x0, spacing, heights);
 		}
+		terrain.build();
 
-		if (t >= 1.0f)
+		for (std::size_t i = 0; i < terrain.segment_count(); ++i)
 		{
-				step = false;
-				elapsed = 0.0f;
-				lerp_pos = step_target_position;
+			const glm::vec2 a = terrain.segment_a(i), d = terrain.segment_b(i) - a;
+			auto ground = engine->add_game_object();
+			auto& quad = ground->drawable();
+			quad.material = engine->quad_mat;
+			quad.transform_origin = Drawable::center_left;
+			quad.size.x = glm::length(d);
+			quad.size.y *= 0.5f;
+			ground->transform().position = a;
+			ground->transform().rotation = std::atan2(d.y, d.x);
 		}
 	}
 
-	void do_step_circular(bool& step, glm::vec2& lerp_pos, GLfloat dt)
+	// Leg hierarchy, hip -> upper limb -> knee -> foot -> lower limb.
+	// The knee points back up the leg so the foot sits one length along it,
+	// and the lower limb turns around again to be drawn from the foot.
+	void attach_leg(const WalkerParts& walker, const LegParts& leg, const LegDesc& desc)
+	{
+		EntityStore& entities = engine->entities;
+		entities.set_parent(leg.hip->entity, walker.body->entity);
+		entities.set_parent(leg.upper->entity, leg.hip->entity);
+		entities.set_parent(leg.knee->entity, leg.upper->entity);
+		entities.set_parent(leg.foot->entity, leg.knee->entity);
+		entities.set_parent(leg.lower->entity, leg.foot->entity);
+
+		leg.hip->transform().position = desc.hip_offset;
+		leg.knee->transform().position = { desc.upper_length, 0 };
+		leg.foot->transform().position = { desc.lower_length, 0 };
+		leg.lower->transform().rotation = -glm::pi<GLfloat>();
+	}
+
+	// Bodies, heads, eyes and limb angles, the rest follows through the hierarchy
+	void update_visuals()
 	{
-		/*
-		if (r_step)
+		PROFILE_ZONE("Prototype::update_visuals");
+		const IKSolverBatch& solved = crowd->rig().solved();
+		for (std::size_t w = 0; w < walkers.size(); ++w)
 		{
-			elapsed += dt;
-			GLfloat frac_complete = elapsed / circ_step_speed;
-			GLfloat angle = lerp(0, glm::pi<GLfloat>(), frac_complete);
-			lerp_position_r = rotate(step_start, pivot_centre, angle);
-			if (frac_complete >= 1.0f)
+			WalkerParts& walker = walkers[w];
+			walker.body->transform().position = crowd->rig().position(w);
+			walker.head->transform().position = crowd->head(w);
+			walker.eye1->transform().position = crowd->eye1(w);
+			walker.eye2->transform().position = crowd->eye2(w);
+
+			const std::size_t first = crowd->rig().first_leg(w);
+			for (std::size_t i = 0; i < walker.legs.size(); ++i)
 			{
-				r_step = false;
-				elapsed = 0.0f;
-				lerp_position_r = step_target_position;
+				walker.legs[i].upper->transform().rotation = solved.angle1[first + i];
+				walker.legs[i].knee->transform().rotation = solved.angle2[first + i] + glm::pi<GLfloat>();
 			}
 		}
-		*/
 	}
-
-
 };
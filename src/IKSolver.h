@@ -1,6 +1,10 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
 #include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
 
 class IKSolver
 {
@@ -15,7 +19,7 @@ public:
 	void solve(const GLfloat l1, const GLfloat l2, const glm::vec2 base, const glm::vec2 target, bool flip_direction)
 	{
 		glm::vec2 end_effector = clamp_distance(target - base, l1, l2);
-		GLfloat effector_vector_angle = atan2(end_effector.y, end_effector.x);
+		GLfloat effector_vector_angle = std::atan2(end_effector.y, end_effector.x);
 		effector_vector_angle = glm::clamp(effector_vector_angle, 0.0f, glm::two_pi<GLfloat>());
 		const GLfloat effector_squared = end_effector.x * end_effector.x + end_effector.y * end_effector.y;
 
@@ -24,13 +28,13 @@ public:
 		// TODO: negate angles on flipped using direction sign instead 
 		if (flip_direction)
 		{
-			angle1 = -acos((l1 * l1 - l2 * l2 + effector_squared) / (2.0f * l1 * sqrt(effector_squared))) + effector_vector_angle;
-			angle2 = -acos((l1 * l1 + l2 * l2 - effector_squared) / (2.0f * l1 * l2));
+			angle1 = -std::acos((l1 * l1 - l2 * l2 + effector_squared) / (2.0f * l1 * std::sqrt(effector_squared))) + effector_vector_angle;
+			angle2 = -std::acos((l1 * l1 + l2 * l2 - effector_squared) / (2.0f * l1 * l2));
 		}
 		else
 		{
-			angle1 = acos((l1 * l1 - l2 * l2 + effector_squared) / (2.0f * l1 * sqrt(effector_squared))) + effector_vector_angle;
-			angle2 = acos((l1 * l1 + l2 * l2 - effector_squared) / (2.0f * l1 * l2));
+			angle1 = std::acos((l1 * l1 - l2 * l2 + effector_squared) / (2.0f * l1 * std::sqrt(effector_squared))) + effector_vector_angle;
+			angle2 = std::acos((l1 * l1 + l2 * l2 - effector_squared) / (2.0f * l1 * l2));
 		}
 			
 		if (std::isnan(angle1)) angle1 = 0.0f;
@@ -38,9 +42,9 @@ public:
 
 		// Positions
 		first = base;
-		second = first + glm::vec2(cos(angle1) * l1, sin(angle1) * l1);
+		second = first + glm::vec2(std::cos(angle1) * l1, std::sin(angle1) * l1);
 		// Todo: simplify calculation
-		last = second + glm::vec2(cos(pi - (-angle2 - angle1)) * l2, sin(pi - (2 * pi - angle2 - angle1)) * l2);
+		last = second + glm::vec2(std::cos(pi - (-angle2 - angle1)) * l2, std::sin(pi - (2 * pi - angle2 - angle1)) * l2);
 
 		// sin(theta) length / distance
 	}
@@ -0,0 +1,343 @@
+#include "IKSolverBatch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <glm/gtc/constants.hpp>
+
+#include "IKSolver.h"
+
+#if defined(__AVX2__)
+#define IK_BATCH_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IK_BATCH_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(IK_BATCH_AVX2) || defined(IK_BATCH_SSE2)
+namespace
+{
+	// Thin wrappers so the kernel below is written once for both widths.
+	// Masks are stored as floats with all bits set (true) or cleared (false).
+#if defined(IK_BATCH_AVX2)
+	struct vf { __m256 v; };
+	struct vi { __m256i v; };
+	constexpr std::size_t width = 8;
+
+	inline vf set1(float f) { return { _mm256_set1_ps(f) }; }
+	inline vf load(const float* p) { return { _mm256_loadu_ps(p) }; }
+	inline void store(float* p, vf a) { _mm256_storeu_ps(p, a.v); }
+	inline vf load_flags(const std::uint8_t* p)
+	{
+		__m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+		__m256i wide = _mm256_cvtepu8_epi32(bytes);
+		return { _mm256_castsi256_ps(_mm256_cmpgt_epi32(wide, _mm256_setzero_si256())) };
+	}
+
+	inline vf operator+(vf a, vf b) { return { _mm256_add_ps(a.v, b.v) }; }
+	inline vf operator-(vf a, vf b) { return { _mm256_sub_ps(a.v, b.v) }; }
+	inline vf operator*(vf a, vf b) { return { _mm256_mul_ps(a.v, b.v) }; }
+	inline vf operator/(vf a, vf b) { return { _mm256_div_ps(a.v, b.v) }; }
+	inline vf operator&(vf a, vf b) { return { _mm256_and_ps(a.v, b.v) }; }
+	inline vf operator^(vf a, vf b) { return { _mm256_xor_ps(a.v, b.v) }; }
+	inline vf operator<(vf a, vf b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+	inline vf operator>(vf a, vf b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ) }; }
+	inline vf operator>=(vf a, vf b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ) }; }
+	inline vf operator<=(vf a, vf b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ) }; }
+	inline vf sqrt(vf a) { return { _mm256_sqrt_ps(a.v) }; }
+	inline vf min(vf a, vf b) { return { _mm256_min_ps(a.v, b.v) }; }
+	inline vf max(vf a, vf b) { return { _mm256_max_ps(a.v, b.v) }; }
+	inline vf select(vf mask, vf a, vf b) { return { _mm256_blendv_ps(b.v, a.v, mask.v) }; }
+
+	inline vi round_to_int(vf a) { return { _mm256_cvtps_epi32(a.v) }; }
+	inline vf to_float(vi a) { return { _mm256_cvtepi32_ps(a.v) }; }
+	inline vi operator+(vi a, vi b) { return { _mm256_add_epi32(a.v, b.v) }; }
+	inline vi operator&(vi a, vi b) { return { _mm256_and_si256(a.v, b.v) }; }
+	inline vi seti(int i) { return { _mm256_set1_epi32(i) }; }
+	inline vi shift_left(vi a, int n) { return { _mm256_slli_epi32(a.v, n) }; }
+	inline vf equal(vi a, vi b) { return { _mm256_castsi256_ps(_mm256_cmpeq_epi32(a.v, b.v)) }; }
+	inline vf as_float(vi a) { return { _mm256_castsi256_ps(a.v) }; }
+#else
+	struct vf { __m128 v; };
+	struct vi { __m128i v; };
+	constexpr std::size_t width = 4;
+
+	inline vf set1(float f) { return { _mm_set1_ps(f) }; }
+	inline vf load(const float* p) { return { _mm_loadu_ps(p) }; }
+	inline void store(float* p, vf a) { _mm_storeu_ps(p, a.v); }
+	inline vf load_flags(const std::uint8_t* p)
+	{
+		int packed;
+		std::memcpy(&packed, p, sizeof(packed));
+		__m128i zero = _mm_setzero_si128();
+		__m128i wide = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+		return { _mm_castsi128_ps(_mm_cmpgt_epi32(wide, zero)) };
+	}
+
+	inline vf operator+(vf a, vf b) { return { _mm_add_ps(a.v, b.v) }; }
+	inline vf operator-(vf a, vf b) { return { _mm_sub_ps(a.v, b.v) }; }
+	inline vf operator*(vf a, vf b) { return { _mm_mul_ps(a.v, b.v) }; }
+	inline vf operator/(vf a, vf b) { return { _mm_div_ps(a.v, b.v) }; }
+	inline vf operator&(vf a, vf b) { return { _mm_and_ps(a.v, b.v) }; }
+	inline vf operator^(vf a, vf b) { return { _mm_xor_ps(a.v, b.v) }; }
+	inline vf operator<(vf a, vf b) { return { _mm_cmplt_ps(a.v, b.v) }; }
+	inline vf operator>(vf a, vf b) { return { _mm_cmpgt_ps(a.v, b.v) }; }
+	inline vf operator>=(vf a, vf b) { return { _mm_cmpge_ps(a.v, b.v) }; }
+	inline vf operator<=(vf a, vf b) { return { _mm_cmple_ps(a.v, b.v) }; }
+	inline vf sqrt(vf a) { return { _mm_sqrt_ps(a.v) }; }
+	inline vf min(vf a, vf b) { return { _mm_min_ps(a.v, b.v) }; }
+	inline vf max(vf a, vf b) { return { _mm_max_ps(a.v, b.v) }; }
+	inline vf select(vf mask, vf a, vf b) { return { _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)) }; }
+
+	inline vi round_to_int(vf a) { return { _mm_cvtps_epi32(a.v) }; }
+	inline vf to_float(vi a) { return { _mm_cvtepi32_ps(a.v) }; }
+	inline vi operator+(vi a, vi b) { return { _mm_add_epi32(a.v, b.v) }; }
+	inline vi operator&(vi a, vi b) { return { _mm_and_si128(a.v, b.v) }; }
+	inline vi seti(int i) { return { _mm_set1_epi32(i) }; }
+	inline vi shift_left(vi a, int n) { return { _mm_slli_epi32(a.v, n) }; }
+	inline vf equal(vi a, vi b) { return { _mm_castsi128_ps(_mm_cmpeq_epi32(a.v, b.v)) }; }
+	inline vf as_float(vi a) { return { _mm_castsi128_ps(a.v) }; }
+#endif
+
+	inline vf sign_mask() { return set1(-0.0f); }
+	inline vf abs(vf a) { return a ^ (a & sign_mask()); }
+
+	// atan on [0, 1], max error ~1e-5 rad
+	inline vf atan_unit(vf a)
+	{
+		const vf s = a * a;
+		vf p = set1(-0.01172120f);
+		p = p * s + set1(0.05265332f);
+		p = p * s + set1(-0.11643287f);
+		p = p * s + set1(0.19354346f);
+		p = p * s + set1(-0.33262347f);
+		p = p * s + set1(0.99997726f);
+		return p * a;
+	}
+
+	inline vf atan2(vf y, vf x)
+	{
+		const vf ax = abs(x);
+		const vf ay = abs(y);
+		const vf hi = max(max(ax, ay), set1(1e-30f));
+		const vf lo = min(ax, ay);
+
+		vf r = atan_unit(lo / hi);
+		r = select(ay > ax, set1(glm::half_pi<float>()) - r, r);
+		r = select(x < set1(0.0f), set1(glm::pi<float>()) - r, r);
+		return r ^ (y & sign_mask());
+	}
+
+	// Abramowitz & Stegun 4.4.46, max error ~2e-8 rad. Input must be within [-1, 1]
+	inline vf acos(vf x)
+	{
+		const vf ax = abs(x);
+		vf p = set1(-0.0012624911f);
+		p = p * ax + set1(0.0066700901f);
+		p = p * ax + set1(-0.0170881256f);
+		p = p * ax + set1(0.0308918810f);
+		p = p * ax + set1(-0.0501743046f);
+		p = p * ax + set1(0.0889789874f);
+		p = p * ax + set1(-0.2145988016f);
+		p = p * ax + set1(1.5707963050f);
+
+		const vf r = sqrt(set1(1.0f) - ax) * p;
+		return select(x < set1(0.0f), set1(glm::pi<float>()) - r, r);
+	}
+
+	// Quadrant reduction followed by the Cephes sinf/cosf polynomials on [-pi/4, pi/4]
+	inline void sincos(vf x, vf& s, vf& c)
+	{
+		const vi j = round_to_int(x * set1(glm::two_over_pi<float>()));
+		const vf jf = to_float(j);
+
+		vf r = x - jf * set1(1.5703125f);
+		r = r - jf * set1(4.837512969970703125e-4f);
+		r = r - jf * set1(7.54978995489188216e-8f);
+		const vf r2 = r * r;
+
+		vf ps = set1(-1.9515295891e-4f);
+		ps = ps * r2 + set1(8.3321608736e-3f);
+		ps = ps * r2 + set1(-1.6666654611e-1f);
+		ps = ps * r2 * r + r;
+
+		vf pc = set1(2.443315711809948e-5f);
+		pc = pc * r2 + set1(-1.388731625493765e-3f);
+		pc = pc * r2 + set1(4.166664568298827e-2f);
+		pc = pc * r2 * r2 - r2 * set1(0.5f) + set1(1.0f);
+
+		const vf swap = equal(j & seti(1), seti(1));
+		const vf sin_sign = as_float(shift_left(j & seti(2), 30));
+		const vf cos_sign = as_float(shift_left((j + seti(1)) & seti(2), 30));
+
+		s = select(swap, pc, ps) ^ sin_sign;
+		c = select(swap, ps, pc) ^ cos_sign;
+	}
+
+	// One register worth of legs, same operation order as IKSolver::solve
+	inline void solve_lanes(const IKBatchInput& in, const IKBatchOutput& out, std::size_t i)
+	{
+		const vf zero = set1(0.0f);
+		const vf one = set1(1.0f);
+		const vf two = set1(2.0f);
+
+		const vf base_x = load(in.base_x + i);
+		const vf base_y = load(in.base_y + i);
+		const vf l1 = load(in.l1 + i);
+		const vf l2 = load(in.l2 + i);
+		const vf flip = load_flags(in.flip_direction + i) & sign_mask();
+
+		// Clamp to prevent stretching
+		const vf dx = load(in.target_x + i) - base_x;
+		const vf dy = load(in.target_y + i) - base_y;
+		const vf length = sqrt(dx * dx + dy * dy);
+		const vf clamped = max(abs(l1 - l2), min(l1 + l2, length));
+		const vf ex = dx * clamped / length;
+		const vf ey = dy * clamped / length;
+
+		const vf effector_angle = max(atan2(ey, ex), zero);
+		const vf effector_squared = ex * ex + ey * ey;
+
+		// Law of Cosines, out of range arguments fall back to 0 like the scalar NaN check
+		const vf cos1 = (l1 * l1 - l2 * l2 + effector_squared) / (two * l1 * sqrt(effector_squared));
+		const vf cos2 = (l1 * l1 + l2 * l2 - effector_squared) / (two * l1 * l2);
+		const vf valid1 = (cos1 >= set1(-1.0f)) & (cos1 <= one);
+		const vf valid2 = (cos2 >= set1(-1.0f)) & (cos2 <= one);
+
+		const vf angle1 = select(valid1, (acos(select(valid1, cos1, one)) ^ flip) + effector_angle, zero);
+		const vf angle2 = select(valid2, acos(select(valid2, cos2, one)) ^ flip, zero);
+
+		// Positions
+		vf s1, c1, s12, c12;
+		sincos(angle1, s1, c1);
+		sincos(angle1 + angle2, s12, c12);
+
+		const vf second_x = base_x + c1 * l1;
+		const vf second_y = base_y + s1 * l1;
+
+		store(out.first_x + i, base_x);
+		store(out.first_y + i, base_y);
+		store(out.second_x + i, second_x);
+		store(out.second_y + i, second_y);
+		store(out.last_x + i, second_x - c12 * l2);
+		store(out.last_y + i, second_y - s12 * l2);
+		store(out.angle1 + i, angle1);
+		store(out.angle2 + i, angle2);
+	}
+}
+#endif
+
+void IKSolverBatch::resize(std::size_t count)
+{
+	for (auto* v : { &base_x, &base_y, &target_x, &target_y, &l1, &l2,
+	                 &first_x, &first_y, &second_x, &second_y, &last_x, &last_y, &angle1, &angle2 })
+		v->resize(count, 0.0f);
+	flip_direction.resize(count, 0);
+}
+
+std::size_t IKSolverBatch::memory_bytes() const
+{
+	std::size_t bytes = flip_direction.capacity();
+	for (const auto* v : { &base_x, &base_y, &target_x, &target_y, &l1, &l2,
+	                       &first_x, &first_y, &second_x, &second_y, &last_x, &last_y, &angle1, &angle2 })
+		bytes += v->capacity() * sizeof(GLfloat);
+	return bytes;
+}
+
+void IKSolverBatch::set_leg(std::size_t i, GLfloat l1, GLfloat l2, glm::vec2 base, glm::vec2 target, bool flip_direction)
+{
+	this->base_x[i] = base.x;
+	this->base_y[i] = base.y;
+	this->target_x[i] = target.x;
+	this->target_y[i] = target.y;
+	this->l1[i] = l1;
+	this->l2[i] = l2;
+	this->flip_direction[i] = flip_direction ? 1 : 0;
+}
+
+IKBatchInput IKSolverBatch::input() const
+{
+	return { base_x.data(), base_y.data(), target_x.data(), target_y.data(), l1.data(), l2.data(), flip_direction.data(), size() };
+}
+
+IKBatchOutput IKSolverBatch::output()
+{
+	return { first_x.data(), first_y.data(), second_x.data(), second_y.data(), last_x.data(), last_y.data(), angle1.data(), angle2.data() };
+}
+
+void IKSolverBatch::solve()
+{
+	solve(input(), output());
+}
+
+void IKSolverBatch::solve(const IKBatchInput& in, const IKBatchOutput& out)
+{
+#if defined(IK_BATCH_AVX2) || defined(IK_BATCH_SSE2)
+	std::size_t i = 0;
+	for (; i + width <= in.count; i += width)
+		solve_lanes(in, out, i);
+
+	if (i == in.count)
+		return;
+
+	// Tail goes through the same kernel via padded stack copies,
+	// so a leg gets the same result no matter where it sits in the batch
+	GLfloat in_lanes[6][width];
+	GLfloat out_lanes[8][width];
+	std::uint8_t flip_lanes[width] = {};
+	for (auto& lane : in_lanes)
+		std::fill(lane, lane + width, 1.0f);
+
+	const std::size_t n = in.count - i;
+	const GLfloat* in_arrays[6] = { in.base_x, in.base_y, in.target_x, in.target_y, in.l1, in.l2 };
+	for (int a = 0; a < 6; ++a)
+		std::copy_n(in_arrays[a] + i, n, in_lanes[a]);
+	std::copy_n(in.flip_direction + i, n, flip_lanes);
+
+	const IKBatchInput tail_in = { in_lanes[0], in_lanes[1], in_lanes[2], in_lanes[3], in_lanes[4], in_lanes[5], flip_lanes, width };
+	const IKBatchOutput tail_out = { out_lanes[0], out_lanes[1], out_lanes[2], out_lanes[3], out_lanes[4], out_lanes[5], out_lanes[6], out_lanes[7] };
+	solve_lanes(tail_in, tail_out, 0);
+
+	GLfloat* out_arrays[8] = { out.first_x, out.first_y, out.second_x, out.second_y, out.last_x, out.last_y, out.angle1, out.angle2 };
+	for (int a = 0; a < 8; ++a)
+		std::copy_n(out_lanes[a], n, out_arrays[a] + i);
+#else
+	IKSolver solver;
+	for (std::size_t i = 0; i < in.count; ++i)
+	{
+		solver.solve(in.l1[i], in.l2[i], { in.base_x[i], in.base_y[i] }, { in.target_x[i], in.target_y[i] }, in.flip_direction[i] != 0);
+		out.first_x[i] = solver.first.x;
+		out.first_y[i] = solver.first.y;
+		out.second_x[i] = solver.second.x;
+		out.second_y[i] = solver.second.y;
+		out.last_x[i] = solver.last.x;
+		out.last_y[i] = solver.last.y;
+		out.angle1[i] = solver.angle1;
+		out.angle2[i] = solver.angle2;
+	}
+#endif
+}
+
+std::size_t IKSolverBatch::count_clamped(const IKBatchInput& in)
+{
+	std::size_t clamped = 0;
+	for (std::size_t i = 0; i < in.count; ++i)
+	{
+		const GLfloat dx = in.target_x[i] - in.base_x[i], dy = in.target_y[i] - in.base_y[i];
+		const GLfloat length = std::sqrt(dx * dx + dy * dy);
+		clamped += length > in.l1[i] + in.l2[i] || length < std::abs(in.l1[i] - in.l2[i]);
+	}
+	return clamped;
+}
+
+const char* IKSolverBatch::kernel_name()
+{
+#if defined(IK_BATCH_AVX2)
+	return "avx2";
+#elif defined(IK_BATCH_SSE2)
+	return "sse2";
+#else
+	return "scalar";
+#endif
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Structure-of-arrays views used by IKSolverBatch. Every pointer addresses `count` elements.
+struct IKBatchInput
+{
+	const GLfloat* base_x;
+	const GLfloat* base_y;
+	const GLfloat* target_x;
+	const GLfloat* target_y;
+	const GLfloat* l1;
+	const GLfloat* l2;
+	const std::uint8_t* flip_direction;
+	std::size_t count;
+};
+
+struct IKBatchOutput
+{
+	GLfloat* first_x;
+	GLfloat* first_y;
+	GLfloat* second_x;
+	GLfloat* second_y;
+	GLfloat* last_x;
+	GLfloat* last_y;
+	GLfloat* angle1;
+	GLfloat* angle2;
+};
+
+// Solves many two bone chains at once with SSE2 / AVX2 kernels.
+// Matches IKSolver::solve: same clamping, same angle conventions and the same
+// "NaN angle becomes 0" fallback when the law of cosines has no solution.
+// atan2, acos and sin/cos are polynomial approximations, so results differ from
+// the scalar solver by at most `angle_tolerance` radians per angle, and by at most
+// `angle_tolerance * (l1 + l2)` per joint position (measured worst case ~2.5e-6).
+// The law of cosines terms use the same float operations as the scalar solver, so both
+// agree on when a leg hits the NaN fallback, as long as neither side is contracted into FMAs.
+class IKSolverBatch
+{
+public:
+	static constexpr GLfloat angle_tolerance = 1e-5f;
+
+	// Inputs
+	std::vector<GLfloat> base_x, base_y, target_x, target_y, l1, l2;
+	std::vector<std::uint8_t> flip_direction;
+
+	// Outputs
+	std::vector<GLfloat> first_x, first_y, second_x, second_y, last_x, last_y, angle1, angle2;
+
+	void resize(std::size_t count);
+	std::size_t size() const { return l1.size(); }
+	// Heap bytes held by the arrays, spare capacity included
+	std::size_t memory_bytes() const;
+
+	void set_leg(std::size_t i, GLfloat l1, GLfloat l2, glm::vec2 base, glm::vec2 target, bool flip_direction);
+	glm::vec2 first(std::size_t i) const { return { first_x[i], first_y[i] }; }
+	glm::vec2 second(std::size_t i) const { return { second_x[i], second_y[i] }; }
+	glm::vec2 last(std::size_t i) const { return { last_x[i], last_y[i] }; }
+
+	IKBatchInput input() const;
+	IKBatchOutput output();
+
+	// Solve every leg stored in this batch
+	void solve();
+
+	// Solve external SoA arrays, input and output may not alias
+	static void solve(const IKBatchInput& in, const IKBatchOutput& out);
+
+	// Legs whose target the solve pulls in or pushes out, the ones clamp_distance would
+	// change in IKSolver: out of reach, or closer than the bones can fold
+	static std::size_t count_clamped(const IKBatchInput& in);
+
+	// Name of the kernel selected at compile time ("avx2", "sse2" or "scalar")
+	static const char* kernel_name();
+};
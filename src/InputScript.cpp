@@ -0,0 +1,139 @@
+#include "InputScript.h"
+#include "Keyboard.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+	struct KeyName
+	{
+		const char* name;
+		int key;
+	};
+
+	const KeyName key_names[] =
+	{
+		{ "RIGHT", GLFW_KEY_RIGHT },
+		{ "LEFT", GLFW_KEY_LEFT },
+		{ "UP", GLFW_KEY_UP },
+		{ "DOWN", GLFW_KEY_DOWN },
+		{ "SPACE", GLFW_KEY_SPACE },
+		{ "ESCAPE", GLFW_KEY_ESCAPE },
+	};
+
+	int parse_key(const std::string& name)
+	{
+		for (const auto& key_name : key_names)
+			if (name == key_name.name)
+				return key_name.key;
+
+		// Letters and digits share their GLFW codes with ASCII
+		if (name.size() == 1 && ((name[0] >= 'A' && name[0] <= 'Z') || (name[0] >= '0' && name[0] <= '9')))
+			return name[0];
+
+		try
+		{
+			return std::stoi(name);
+		}
+		catch (const std::exception&)
+		{
+			return -1;
+		}
+	}
+}
+
+void InputScript::press(std::uint64_t tick, int key)
+{
+	add({ tick, key, true });
+}
+
+void InputScript::release(std::uint64_t tick, int key)
+{
+	add({ tick, key, false });
+}
+
+void InputScript::add(const Event& event)
+{
+	// Keep events sorted by tick, in insertion order within a tick
+	auto at = std::upper_bound(events_.begin(), events_.end(), event.tick,
+		[](std::uint64_t tick, const Event& other) { return tick < other.tick; });
+	events_.insert(at, event);
+}
+
+bool InputScript::load(const std::string& file_name)
+{
+	std::ifstream file(file_name);
+	if (!file)
+	{
+		std::cerr << "Failed to open input script: " << file_name << std::endl;
+		return false;
+	}
+
+	InputScript script;
+	std::string line;
+	for (int line_number = 1; std::getline(file, line); ++line_number)
+	{
+		std::istringstream words(line);
+		std::string first, key, action;
+		if (!(words >> first) || first[0] == '#')
+			continue;
+
+		if (first == "loop")
+		{
+			std::uint64_t ticks;
+			if (words >> ticks)
+			{
+				script.set_loop(ticks);
+				continue;
+			}
+		}
+		else if (words >> key >> action && (action == "down" || action == "up"))
+		{
+			char* end = nullptr;
+			const std::uint64_t tick = std::strtoull(first.c_str(), &end, 10);
+			const int code = parse_key(key);
+			if (*end == '\0' && code >= 0 && code < GLFW_KEY_LAST)
+			{
+				script.add({ tick, code, action == "down" });
+				continue;
+			}
+		}
+
+		std::cerr << "Bad input script line " << file_name << ":" << line_number << ": " << line << std::endl;
+		return false;
+	}
+
+	*this = std::move(script);
+	return true;
+}
+
+InputScript InputScript::walk_back_and_forth(std::uint64_t ticks_per_direction)
+{
+	InputScript script;
+	script.press(0, GLFW_KEY_RIGHT);
+	script.release(ticks_per_direction, GLFW_KEY_RIGHT);
+	script.press(ticks_per_direction, GLFW_KEY_LEFT);
+	script.set_loop(ticks_per_direction * 2);
+	return script;
+}
+
+void InputScript::apply(std::uint64_t tick) const
+{
+	if (loop_ != 0)
+	{
+		// Start every lap from a clean keyboard
+		if (tick != 0 && tick % loop_ == 0)
+			for (const auto& event : events_)
+				Keyboard::set_key(event.key, false);
+		tick %= loop_;
+	}
+
+	auto first = std::lower_bound(events_.begin(), events_.end(), tick,
+		[](const Event& event, std::uint64_t tick) { return event.tick < tick; });
+	for (auto it = first; it != events_.end() && it->tick == tick; ++it)
+		Keyboard::set_key(it->key, it->down);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Key presses and releases keyed to simulation ticks, fed into Keyboard in place of
+// the GLFW callback so headless runs see the same input every time.
+//
+// Script files hold one event per line, "<tick> <key> <down|up>", where key is a GLFW
+// key code or a name like RIGHT, SPACE or Q. "loop <ticks>" restarts the script every
+// <ticks> ticks with all its keys released. Lines starting with # are ignored.
+class InputScript
+{
+public:
+	struct Event
+	{
+		std::uint64_t tick;
+		int key;
+		bool down;
+	};
+
+	void press(std::uint64_t tick, int key);
+	void release(std::uint64_t tick, int key);
+
+	// 0 plays the script once
+	void set_loop(std::uint64_t ticks) { loop_ = ticks; }
+
+	// Returns false and leaves the script untouched when the file can't be parsed
+	bool load(const std::string& file_name);
+
+	// Walks right, then left, forever
+	static InputScript walk_back_and_forth(std::uint64_t ticks_per_direction);
+
+	// Pushes the events of `tick` into Keyboard
+	void apply(std::uint64_t tick) const;
+
+	const std::vector<Event>& events() const { return events_; }
+
+private:
+	void add(const Event& event);
+
+	std::vector<Event> events_;
+	std::uint64_t loop_ = 0;
+};
@@ -0,0 +1,224 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+namespace
+{
+	// System the calling thread works for and the index of its queue
+	thread_local const JobSystem* tls_system = nullptr;
+	thread_local unsigned tls_index = 0;
+
+	// Batches handed to each thread in non deterministic mode, some slack for stealing
+	constexpr std::size_t batches_per_thread = 4;
+}
+
+JobSystem::JobSystem(unsigned thread_count, bool deterministic)
+	: deterministic_(deterministic)
+{
+	if (thread_count == 0)
+		thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+	for (unsigned i = 0; i < thread_count; ++i)
+		queues_.push_back(std::make_unique<Queue>());
+
+	tls_system = this;
+	tls_index = 0;
+
+	for (unsigned i = 1; i < thread_count; ++i)
+		threads_.emplace_back(&JobSystem::worker_loop, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex_);
+		running_ = false;
+	}
+	wake_.notify_all();
+
+	for (auto& thread : threads_)
+		thread.join();
+
+	if (tls_system == this)
+		tls_system = nullptr;
+}
+
+void JobSystem::submit(std::function<void()> job, JobCounter* counter)
+{
+	auto* function = new std::function<void()>(std::move(job));
+	if (counter)
+		counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+	push({ [](void* data, std::size_t, std::size_t)
+	{
+		auto* function = static_cast<std::function<void()>*>(data);
+		(*function)();
+		delete function;
+	}, function, 0, 0, counter });
+}
+
+void JobSystem::submit_after(JobCounter& dependency, std::function<void()> job, JobCounter* counter)
+{
+	if (counter)
+		counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+	// The continuation owns the counter increment made above
+	auto continuation = [this, job = std::move(job), counter]() mutable
+	{
+		submit(std::move(job), counter);
+		if (counter)
+			finish(*counter);
+	};
+
+	{
+		std::lock_guard<std::mutex> lock(dependency.mutex_);
+		if (!dependency.done())
+		{
+			dependency.continuations_.push_back(std::move(continuation));
+			return;
+		}
+	}
+	continuation();
+}
+
+void JobSystem::wait(JobCounter& counter)
+{
+	Job job;
+	while (!counter.done())
+	{
+		if (pop_or_steal(job))
+			execute(job);
+		else
+			std::this_thread::yield();
+	}
+
+	// The last finish() may still hold the lock
+	std::lock_guard<std::mutex> lock(counter.mutex_);
+}
+
+void JobSystem::push(const Job& job)
+{
+	// Foreign threads feed worker 0
+	const unsigned index = tls_system == this ? tls_index : 0;
+	{
+		std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+		queues_[index]->jobs.push_back(job);
+	}
+	queued_.fetch_add(1, std::memory_order_release);
+
+	// Taking the lock orders this wake up after a sleeper's predicate check
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex_);
+	}
+	wake_.notify_one();
+}
+
+bool JobSystem::pop_or_steal(Job& job)
+{
+	if (queued_.load(std::memory_order_acquire) == 0)
+		return false;
+
+	const unsigned count = thread_count();
+	const unsigned own = tls_system == this ? tls_index : 0;
+
+	// Own queue newest first, everyone else's oldest first
+	for (unsigned i = 0; i < count; ++i)
+	{
+		Queue& queue = *queues_[(own + i) % count];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.jobs.empty())
+			continue;
+
+		if (i == 0)
+		{
+			job = queue.jobs.back();
+			queue.jobs.pop_back();
+		}
+		else
+		{
+			job = queue.jobs.front();
+			queue.jobs.pop_front();
+		}
+		queued_.fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	}
+	return false;
+}
+
+void JobSystem::execute(const Job& job)
+{
+	job.function(job.data, job.begin, job.end);
+	if (job.counter)
+		finish(*job.counter);
+}
+
+void JobSystem::finish(JobCounter& counter)
+{
+	// Decrement under the lock, wait() takes it too before letting the counter go out of scope
+	std::vector<std::function<void()>> continuations;
+	{
+		std::lock_guard<std::mutex> lock(counter.mutex_);
+		if (counter.pending.fetch_sub(1, std::memory_order_acq_rel) != 1)
+			return;
+		continuations.swap(counter.continuations_);
+	}
+	for (auto& continuation : continuations)
+		continuation();
+}
+
+void JobSystem::worker_loop(unsigned index)
+{
+	tls_system = this;
+	tls_index = index;
+
+	Job job;
+	while (running_)
+	{
+		if (pop_or_steal(job))
+		{
+			execute(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleep_mutex_);
+		wake_.wait(lock, [this] { return !running_ || queued_.load(std::memory_order_acquire) > 0; });
+	}
+}
+
+void JobSystem::run_batches(std::size_t count, std::size_t min_batch, void (*function)(void*, std::size_t, std::size_t), void* data)
+{
+	min_batch = std::max<std::size_t>(min_batch, 1);
+	if (count <= min_batch)
+	{
+		if (count > 0)
+			function(data, 0, count);
+		return;
+	}
+
+	if (thread_count() == 1)
+	{
+		// Keep the batch boundaries when deterministic, a single call otherwise
+		const std::size_t step = deterministic_ ? min_batch : count;
+		for (std::size_t begin = 0; begin < count; begin += step)
+			function(data, begin, std::min(count, begin + step));
+		return;
+	}
+
+	std::size_t batch = min_batch;
+	if (!deterministic_)
+	{
+		const std::size_t target = count / (thread_count() * batches_per_thread);
+		batch = std::max(min_batch, target);
+	}
+
+	// Queue every batch but the first, which runs right here
+	JobCounter counter;
+	for (std::size_t begin = batch; begin < count; begin += batch)
+	{
+		counter.pending.fetch_add(1, std::memory_order_relaxed);
+		push({ function, data, begin, std::min(count, begin + batch), &counter });
+	}
+
+	function(data, 0, batch);
+	wait(counter);
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Counts jobs that are still in flight. wait() on it to join them, or use it
+// as a dependency for jobs submitted with JobSystem::submit_after.
+// Call JobSystem::wait before a counter with jobs attached goes out of scope.
+struct JobCounter
+{
+	std::atomic<int> pending{ 0 };
+
+	bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class JobSystem;
+	std::mutex mutex_;
+	std::vector<std::function<void()>> continuations_;
+};
+
+// Work stealing job system. Every thread owns a deque, it pops its own work from the
+// back and steals from the front of the others when it runs dry. The thread that creates
+// the system is worker 0 and helps out while it waits.
+class JobSystem
+{
+public:
+	// thread_count 0 uses every hardware thread. Deterministic mode splits parallel_for
+	// ranges into the same batches no matter how many threads run them, so per batch
+	// results (partial sums, output order) are reproducible across machines.
+	explicit JobSystem(unsigned thread_count = 0, bool deterministic = false);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	void submit(std::function<void()> job, JobCounter* counter = nullptr);
+
+	// Queue `job` once `dependency` has no pending jobs left
+	void submit_after(JobCounter& dependency, std::function<void()> job, JobCounter* counter = nullptr);
+
+	// Runs other jobs until the counter reaches zero
+	void wait(JobCounter& counter);
+
+	// Calls fn(begin, end) over [0, count) in batches of at least min_batch elements.
+	// Ranges at or below min_batch run inline on the calling thread.
+	template <typename Fn>
+	void parallel_for(std::size_t count, std::size_t min_batch, Fn&& fn)
+	{
+		using Function = std::remove_reference_t<Fn>;
+		run_batches(count, min_batch, [](void* data, std::size_t begin, std::size_t end)
+		{
+			(*static_cast<Function*>(data))(begin, end);
+		}, const_cast<void*>(static_cast<const void*>(&fn)));
+	}
+
+	unsigned thread_count() const { return static_cast<unsigned>(queues_.size()); }
+	bool deterministic() const { return deterministic_; }
+
+private:
+	struct Job
+	{
+		void (*function)(void* data, std::size_t begin, std::size_t end);
+		void* data;
+		std::size_t begin, end;
+		JobCounter* counter;
+	};
+
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	void push(const Job& job);
+	bool pop_or_steal(Job& job);
+	void execute(const Job& job);
+	void finish(JobCounter& counter);
+	void worker_loop(unsigned index);
+	void run_batches(std::size_t count, std::size_t min_batch, void (*function)(void*, std::size_t, std::size_t), void* data);
+
+	std::vector<std::unique_ptr<Queue>> queues_;
+	std::vector<std::thread> threads_;
+	std::atomic<int> queued_{ 0 };
+	std::atomic<bool> running_{ true };
+	std::mutex sleep_mutex_;
+	std::condition_variable wake_;
+	bool deterministic_;
+};
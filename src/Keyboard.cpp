@@ -1,10 +1,14 @@
 #include "Keyboard.h"
 
-bool Keyboard::keys_[GLFW_KEY_LAST] = { false };
-bool Keyboard::keys_changed_[GLFW_KEY_LAST] = { false };
+// GLFW_KEY_LAST is a valid key
+bool Keyboard::keys_[GLFW_KEY_LAST + 1] = { false };
+bool Keyboard::keys_changed_[GLFW_KEY_LAST + 1] = { false };
 
 void Keyboard::key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
+	if (key == GLFW_KEY_UNKNOWN)
+		return;
+
 	if (action != GLFW_RELEASE)
 	{
 		if (!keys_[key])
@@ -15,6 +19,12 @@ void Keyboard::key_callback(GLFWwindow* window, int key, int scancode, int actio
 	keys_changed_[key] = action != GLFW_REPEAT;
 }
 
+void Keyboard::set_key(int key, bool down)
+{
+	keys_changed_[key] = keys_[key] != down;
+	keys_[key] = down;
+}
+
 bool Keyboard::key(int key)
 {
 	return keys_[key];
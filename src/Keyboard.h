@@ -14,6 +14,9 @@ public:
 	static bool key_up(int key);
 	static bool key_down(int key);
 
+	// Drives the key state without a window, for scripted input
+	static void set_key(int key, bool down);
+
 private:
 	static bool keys_[];
 	static bool keys_changed_[];
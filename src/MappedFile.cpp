@@ -0,0 +1,73 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const std::string& file_name)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER size;
+	HANDLE mapping = GetFileSizeEx(file, &size) ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+	void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (!view)
+	{
+		if (mapping)
+			CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+	file_ = file;
+	mapping_ = mapping;
+	data_ = static_cast<const unsigned char*>(view);
+	size_ = static_cast<std::size_t>(size.QuadPart);
+#else
+	const int fd = ::open(file_name.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat info;
+	void* view = MAP_FAILED;
+	if (fstat(fd, &info) == 0 && info.st_size > 0)
+		view = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping keeps the file alive
+	::close(fd);
+	if (view == MAP_FAILED)
+		return false;
+	data_ = static_cast<const unsigned char*>(view);
+	size_ = static_cast<std::size_t>(info.st_size);
+#endif
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (!data_)
+		return;
+#ifdef _WIN32
+	UnmapViewOfFile(data_);
+	CloseHandle(static_cast<HANDLE>(mapping_));
+	CloseHandle(static_cast<HANDLE>(file_));
+	file_ = mapping_ = nullptr;
+#else
+	munmap(const_cast<unsigned char*>(data_), size_);
+#endif
+	data_ = nullptr;
+	size_ = 0;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// A whole file mapped read only. Pointers into it stay valid until close().
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// False for missing and empty files
+	bool open(const std::string& file_name);
+	void close();
+	bool is_open() const { return data_ != nullptr; }
+
+	const unsigned char* data() const { return data_; }
+	std::size_t size() const { return size_; }
+
+private:
+	const unsigned char* data_ = nullptr;
+	std::size_t size_ = 0;
+#ifdef _WIN32
+	void* file_ = nullptr;
+	void* mapping_ = nullptr;
+#endif
+};
@@ -18,8 +18,8 @@ double Mouse::scroll_dy_;
 
 bool Mouse::first_mouse;
 
-bool Mouse::buttons_[GLFW_MOUSE_BUTTON_LAST] = { 0 };
-bool Mouse::buttons_changed_[GLFW_MOUSE_BUTTON_LAST] = { 0 };
+bool Mouse::buttons_[GLFW_MOUSE_BUTTON_LAST + 1] = { 0 };
+bool Mouse::buttons_changed_[GLFW_MOUSE_BUTTON_LAST + 1] = { 0 };
 
 
 void Mouse::cursor_pos_callback(GLFWwindow* window, double pos_x, double pos_y)
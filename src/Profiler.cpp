@@ -0,0 +1,170 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	struct Event
+	{
+		const char* name;
+		std::uint64_t start, end;
+	};
+
+	// Written only by its own thread, read by the exporter
+	struct ThreadBuffer
+	{
+		std::uint32_t id;
+		std::vector<Event> events;
+		std::atomic<std::uint64_t> written{ 0 };
+	};
+
+	// Frame boundaries and durations, touched by the thread that ends frames
+	struct Frames
+	{
+		std::vector<double> durations = std::vector<double>(Profiler::stats_frames, 0.0);
+		std::size_t count = 0;
+		std::uint64_t last_end = 0;
+	};
+
+	const Clock::time_point origin = Clock::now();
+	std::atomic<bool> profiling{ false };
+
+	std::mutex buffers_mutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+	thread_local ThreadBuffer* tls_buffer = nullptr;
+
+	Frames frames;
+	const char* const frame_zone = "frame";
+
+	ThreadBuffer& thread_buffer()
+	{
+		if (!tls_buffer)
+		{
+			auto buffer = std::make_unique<ThreadBuffer>();
+			buffer->events.resize(Profiler::events_per_thread);
+
+			std::lock_guard<std::mutex> lock(buffers_mutex);
+			buffer->id = static_cast<std::uint32_t>(buffers.size());
+			tls_buffer = buffer.get();
+			buffers.push_back(std::move(buffer));
+		}
+		return *tls_buffer;
+	}
+
+	void write_escaped(std::ostream& out, const char* text)
+	{
+		for (; *text; ++text)
+		{
+			if (*text == '"' || *text == '\\')
+				out << '\\';
+			out << *text;
+		}
+	}
+}
+
+void Profiler::set_enabled(bool enabled)
+{
+	if (enabled && !profiling)
+		frames.last_end = now();
+	profiling.store(enabled, std::memory_order_relaxed);
+}
+
+bool Profiler::enabled()
+{
+	return profiling.load(std::memory_order_relaxed);
+}
+
+std::uint64_t Profiler::now()
+{
+	return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - origin).count());
+}
+
+void Profiler::record(const char* name, std::uint64_t start, std::uint64_t end)
+{
+	ThreadBuffer& buffer = thread_buffer();
+	const std::uint64_t written = buffer.written.load(std::memory_order_relaxed);
+	buffer.events[written % events_per_thread] = { name, start, end };
+	buffer.written.store(written + 1, std::memory_order_release);
+}
+
+void Profiler::end_frame()
+{
+	if (!enabled())
+		return;
+
+	const std::uint64_t end = now();
+	record(frame_zone, frames.last_end, end);
+
+	frames.durations[frames.count % stats_frames] = (end - frames.last_end) * 1e-6;
+	++frames.count;
+	frames.last_end = end;
+}
+
+FrameStats Profiler::frame_stats()
+{
+	FrameStats stats;
+	stats.frames = std::min(frames.count, stats_frames);
+	if (stats.frames == 0)
+		return stats;
+
+	std::vector<double> sorted(frames.durations.begin(), frames.durations.begin() + stats.frames);
+	std::sort(sorted.begin(), sorted.end());
+
+	double sum = 0.0;
+	for (double duration : sorted)
+		sum += duration;
+
+	stats.min = sorted.front();
+	stats.max = sorted.back();
+	stats.avg = sum / stats.frames;
+	stats.p99 = sorted[std::min(stats.frames - 1, stats.frames * 99 / 100)];
+	return stats;
+}
+
+bool Profiler::write_chrome_trace(const std::string& file_name)
+{
+	std::ofstream out(file_name);
+	if (!out)
+	{
+		std::cerr << "Failed to open trace file: " << file_name << std::endl;
+		return false;
+	}
+
+	out << std::fixed << std::setprecision(3);
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+
+	std::lock_guard<std::mutex> lock(buffers_mutex);
+	for (const auto& buffer : buffers)
+	{
+		if (!first) out << ",\n";
+		first = false;
+		out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << buffer->id
+			<< ",\"args\":{\"name\":\"thread " << buffer->id << "\"}}";
+
+		// Complete events, timestamps in microseconds
+		const std::uint64_t written = buffer->written.load(std::memory_order_acquire);
+		const std::uint64_t oldest = written > events_per_thread ? written - events_per_thread : 0;
+		for (std::uint64_t i = oldest; i < written; ++i)
+		{
+			const Event& event = buffer->events[i % events_per_thread];
+			out << ",\n{\"name\":\"";
+			write_escaped(out, event.name);
+			out << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer->id
+				<< ",\"ts\":" << event.start / 1000.0 << ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+		}
+	}
+	out << "\n]}\n";
+
+	return static_cast<bool>(out);
+}
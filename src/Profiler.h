@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Zones compile away entirely with TINYENGINE_PROFILE=0. Compiled in but disabled at
+// runtime they cost one relaxed load and a branch.
+#ifndef TINYENGINE_PROFILE
+#define TINYENGINE_PROFILE 1
+#endif
+
+struct FrameStats
+{
+	// Milliseconds over the rolling window
+	double min = 0.0, avg = 0.0, p99 = 0.0, max = 0.0;
+	std::size_t frames = 0;
+};
+
+// CPU profiler. Zones are recorded into a ring buffer owned by the thread that runs them,
+// so recording never takes a lock. Zone names must outlive the profiler (string literals).
+class Profiler
+{
+public:
+	// Events kept per thread before the oldest are overwritten
+	static constexpr std::size_t events_per_thread = 1 << 16;
+	// Frames in the rolling stats window
+	static constexpr std::size_t stats_frames = 240;
+
+	static void set_enabled(bool enabled);
+	static bool enabled();
+
+	// Nanoseconds since the profiler started
+	static std::uint64_t now();
+
+	static void record(const char* name, std::uint64_t start, std::uint64_t end);
+
+	// Marks the end of a frame for the rolling stats and the trace
+	static void end_frame();
+	static FrameStats frame_stats();
+
+	// Writes every buffered event as Chrome trace-event JSON (chrome://tracing, Perfetto).
+	// Call between frames, threads still recording may tear their newest events.
+	static bool write_chrome_trace(const std::string& file_name);
+};
+
+class ProfileZone
+{
+public:
+	explicit ProfileZone(const char* name)
+		: name_(Profiler::enabled() ? name : nullptr), start_(name_ ? Profiler::now() : 0)
+	{}
+	~ProfileZone()
+	{
+		if (name_)
+			Profiler::record(name_, start_, Profiler::now());
+	}
+
+	ProfileZone(const ProfileZone&) = delete;
+	ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+	const char* name_;
+	std::uint64_t start_;
+};
+
+#if TINYENGINE_PROFILE
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#endif
@@ -0,0 +1,317 @@
+#include "Replay.h"
+#include "Camera.h"
+#include "Keyboard.h"
+#include "Mouse.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+	const char replay_magic[4] = { 'T', 'E', 'R', 'L' };
+
+	// Keys, then mouse buttons, the LAST codes are valid ones
+	constexpr int key_count = GLFW_KEY_LAST + 1;
+	constexpr int input_count = key_count + GLFW_MOUSE_BUTTON_LAST + 1;
+	constexpr GLfloat cursor_steps = 16.0f;
+	constexpr std::uint64_t max_state_words = 1 << 26;
+
+	enum RecordFlags : unsigned char
+	{
+		cursor_moved = 1,
+		camera_moved = 2,
+	};
+
+	bool input_down(int input)
+	{
+		return input < key_count ? Keyboard::key(input) : Mouse::button(input - key_count);
+	}
+
+	void set_input(int input, bool down)
+	{
+		if (input < key_count)
+			Keyboard::set_key(input, down);
+		else
+			Mouse::mouse_button_callback(nullptr, input - key_count, down ? GLFW_PRESS : GLFW_RELEASE, 0);
+	}
+
+	void put_varint(std::vector<unsigned char>& bytes, std::uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			bytes.push_back(static_cast<unsigned char>(value | 0x80));
+			value >>= 7;
+		}
+		bytes.push_back(static_cast<unsigned char>(value));
+	}
+
+	void put_signed(std::vector<unsigned char>& bytes, std::int64_t value)
+	{
+		put_varint(bytes, (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63));
+	}
+
+	void put_float(std::vector<unsigned char>& bytes, GLfloat value)
+	{
+		unsigned char raw[4];
+		std::memcpy(raw, &value, 4);
+		bytes.insert(bytes.end(), raw, raw + 4);
+	}
+
+	// Readers leave read at end once they run out, which every caller checks for
+	bool get_varint(const unsigned char*& read, const unsigned char* end, std::uint64_t& value)
+	{
+		value = 0;
+		for (int shift = 0; read < end && shift < 64; shift += 7)
+		{
+			const unsigned char byte = *read++;
+			value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+			if (!(byte & 0x80))
+				return true;
+		}
+		read = end;
+		return false;
+	}
+
+	bool get_signed(const unsigned char*& read, const unsigned char* end, std::int64_t& value)
+	{
+		std::uint64_t zigzag;
+		if (!get_varint(read, end, zigzag))
+			return false;
+		value = static_cast<std::int64_t>(zigzag >> 1) ^ -static_cast<std::int64_t>(zigzag & 1);
+		return true;
+	}
+
+	bool get_float(const unsigned char*& read, const unsigned char* end, GLfloat& value)
+	{
+		if (end - read < 4)
+		{
+			read = end;
+			return false;
+		}
+		std::memcpy(&value, read, 4);
+		read += 4;
+		return true;
+	}
+
+	std::int64_t to_steps(double position)
+	{
+		return static_cast<std::int64_t>(std::llround(position * cursor_steps));
+	}
+}
+
+ReplayRecorder::ReplayRecorder(GLfloat tick_rate, bool record_state)
+	: tick_rate_(tick_rate), record_state_(record_state), inputs_(input_count, 0)
+{
+}
+
+void ReplayRecorder::record_input(const Camera& camera)
+{
+	++tick_count_;
+	const std::size_t flags_at = bytes_.size();
+	bytes_.push_back(0);
+
+	std::vector<std::uint64_t> changes;
+	for (int input = 0; input < input_count; ++input)
+	{
+		const std::uint8_t down = input_down(input) ? 1 : 0;
+		if (down != inputs_[input])
+			changes.push_back(static_cast<std::uint64_t>(input) << 1 | down);
+		inputs_[input] = down;
+	}
+	put_varint(bytes_, changes.size());
+	for (std::uint64_t change : changes)
+		put_varint(bytes_, change);
+
+	const std::int64_t cursor_x = to_steps(Mouse::get_mouse_x()), cursor_y = to_steps(Mouse::get_mouse_y());
+	if (cursor_x != cursor_x_ || cursor_y != cursor_y_)
+	{
+		bytes_[flags_at] |= cursor_moved;
+		put_signed(bytes_, cursor_x - cursor_x_);
+		put_signed(bytes_, cursor_y - cursor_y_);
+		cursor_x_ = cursor_x;
+		cursor_y_ = cursor_y;
+	}
+
+	const GLfloat view[3] = { camera.position.x, camera.position.y, camera.zoom };
+	if (std::memcmp(view, camera_, sizeof(view)) != 0)
+	{
+		bytes_[flags_at] |= camera_moved;
+		for (GLfloat value : view)
+			put_float(bytes_, value);
+		std::memcpy(camera_, view, sizeof(view));
+	}
+}
+
+void ReplayRecorder::record_state(const std::vector<GLfloat>& state)
+{
+	if (!record_state_)
+		return;
+
+	// Each word is predicted to move on by as much as it did last tick. Words that do cost a
+	// share of one run length, and floats that keep their exponent miss by a few low bits.
+	const std::size_t count = state.size();
+	state_.resize(count, 0);
+	steps_.resize(count, 0);
+	put_varint(bytes_, count);
+	for (std::size_t i = 0; i < count;)
+	{
+		std::size_t run = 0;
+		std::uint32_t word, predicted;
+		for (; i < count; ++i, ++run)
+		{
+			std::memcpy(&word, &state[i], 4);
+			predicted = state_[i] + steps_[i];
+			if (word != predicted)
+				break;
+			state_[i] = word;
+		}
+		put_varint(bytes_, run);
+		if (i == count)
+			break;
+		put_signed(bytes_, static_cast<std::int32_t>(word - predicted));
+		steps_[i] = word - state_[i];
+		state_[i++] = word;
+	}
+}
+
+bool ReplayRecorder::write(const std::string& file_name) const
+{
+	std::ofstream out(file_name, std::ios::binary);
+	if (!out)
+	{
+		std::cerr << "Failed to open replay for writing: " << file_name << std::endl;
+		return false;
+	}
+
+	ReplayHeader header = {};
+	std::memcpy(header.magic, replay_magic, 4);
+	header.version = ReplayLog::version;
+	header.tick_rate = tick_rate_;
+	header.flags = record_state_ ? static_cast<std::uint32_t>(ReplayHeader::has_state) : 0u;
+	header.tick_count = tick_count_;
+
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.write(reinterpret_cast<const char*>(bytes_.data()), bytes_.size());
+	if (!out)
+		return false;
+
+	std::cout << "Recorded " << tick_count_ << " ticks to " << file_name << ", " << bytes() << " bytes ("
+		<< static_cast<double>(bytes_.size()) / std::max<std::uint64_t>(tick_count_, 1) << " per tick)" << std::endl;
+	return true;
+}
+
+bool ReplayLog::open(const std::string& file_name)
+{
+	tick_count_ = applied_ = 0;
+	if (!file_.open(file_name))
+	{
+		std::cerr << "Failed to open replay: " << file_name << std::endl;
+		return false;
+	}
+
+	ReplayHeader header = {};
+	if (file_.size() >= sizeof(header))
+		std::memcpy(&header, file_.data(), sizeof(header));
+	if (std::memcmp(header.magic, replay_magic, 4) != 0 || header.version != version || !(header.tick_rate > 0.0f))
+	{
+		std::cerr << "Invalid replay: " << file_name << std::endl;
+		file_.close();
+		return false;
+	}
+
+	read_ = file_.data() + sizeof(header);
+	end_ = file_.data() + file_.size();
+	tick_count_ = header.tick_count;
+	tick_rate_ = header.tick_rate;
+	has_state_ = (header.flags & ReplayHeader::has_state) != 0;
+	damaged_ = false;
+	inputs_.assign(input_count, 0);
+	cursor_x_ = cursor_y_ = 0;
+	words_.clear();
+	steps_.clear();
+	state_.clear();
+	return true;
+}
+
+bool ReplayLog::apply(Camera& camera)
+{
+	if (finished())
+		return false;
+
+	bool valid = read_ < end_;
+	const unsigned char flags = valid ? *read_++ : 0;
+
+	std::uint64_t changes = 0;
+	valid = valid && get_varint(read_, end_, changes);
+	for (std::uint64_t i = 0; valid && i < changes; ++i)
+	{
+		std::uint64_t change;
+		valid = get_varint(read_, end_, change) && (change >> 1) < static_cast<std::uint64_t>(input_count);
+		if (valid)
+			inputs_[change >> 1] = change & 1;
+	}
+
+	if (valid && (flags & cursor_moved))
+	{
+		std::int64_t dx, dy;
+		valid = get_signed(read_, end_, dx) && get_signed(read_, end_, dy);
+		if (valid)
+		{
+			cursor_x_ += dx;
+			cursor_y_ += dy;
+			Mouse::cursor_pos_callback(nullptr, cursor_x_ / cursor_steps, cursor_y_ / cursor_steps);
+		}
+	}
+
+	if (valid && (flags & camera_moved))
+		valid = get_float(read_, end_, camera.position.x) && get_float(read_, end_, camera.position.y) && get_float(read_, end_, camera.zoom);
+
+	if (valid && has_state_)
+	{
+		std::uint64_t count = 0;
+		// A damaged count must not allocate gigabytes
+		valid = get_varint(read_, end_, count) && count <= max_state_words;
+		if (valid)
+		{
+			words_.resize(static_cast<std::size_t>(count), 0);
+			steps_.resize(words_.size(), 0);
+		}
+		for (std::size_t i = 0; valid && i < words_.size();)
+		{
+			std::uint64_t run;
+			valid = get_varint(read_, end_, run) && run <= words_.size() - i;
+			if (!valid)
+				break;
+			for (const std::size_t run_end = i + static_cast<std::size_t>(run); i < run_end; ++i)
+				words_[i] += steps_[i];
+			if (i == words_.size())
+				break;
+			std::int64_t miss;
+			valid = get_signed(read_, end_, miss);
+			const std::uint32_t word = words_[i] + steps_[i] + static_cast<std::uint32_t>(miss);
+			steps_[i] = word - words_[i];
+			words_[i++] = word;
+		}
+		state_.resize(words_.size());
+		if (!words_.empty())
+			std::memcpy(state_.data(), words_.data(), words_.size() * 4);
+	}
+
+	if (!valid)
+	{
+		std::cerr << "Replay is damaged at tick " << applied_ << ", stopping there" << std::endl;
+		damaged_ = true;
+		return false;
+	}
+
+	// The whole input state every tick, so live events can not leak into the replay
+	for (int input = 0; input < input_count; ++input)
+		if (input_down(input) != (inputs_[input] != 0))
+			set_input(input, inputs_[input] != 0);
+
+	++applied_;
+	return true;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+
+#include "MappedFile.h"
+
+struct Camera;
+
+// Tick by tick recording of everything the simulation reads from outside, written by
+// ReplayRecorder and played back through a mapping by ReplayLog.
+//
+//   ReplayHeader | one record per tick
+//
+// A record holds only what changed since the tick before:
+//   u8 flags (cursor_moved, camera_moved)
+//   varint count, then count varints (input << 1 | down), keys 0 to GLFW_KEY_LAST first,
+//   mouse buttons after from GLFW_KEY_LAST + 1
+//   cursor_moved: zigzag varint dx, dy in 1/16 pixels
+//   camera_moved: f32 position x, position y, zoom
+//   has_state only: varint word count, then pairs of varint run of words that moved on by
+//   the same step as last tick, zigzag varint miss of the next word's bits against that,
+//   until the count is covered
+// Varints are little endian base 128, all other fields little endian.
+struct ReplayHeader
+{
+	enum Flags : std::uint32_t
+	{
+		has_state = 1,
+	};
+
+	char magic[4];
+	std::uint32_t version;
+	GLfloat tick_rate;
+	std::uint32_t flags;
+	std::uint64_t tick_count;
+};
+
+static_assert(sizeof(ReplayHeader) == 24, "ReplayHeader layout is part of the file format");
+
+// Keyboard, Mouse and the camera as each tick starts, the game's state as it ends. Kept in
+// memory and written out at the end.
+class ReplayRecorder
+{
+public:
+	ReplayRecorder(GLfloat tick_rate, bool record_state);
+
+	// Call before every tick's update
+	void record_input(const Camera& camera);
+	// Call after every tick's update, ignored unless recording state
+	void record_state(const std::vector<GLfloat>& state);
+
+	bool records_state() const { return record_state_; }
+	std::uint64_t tick_count() const { return tick_count_; }
+	std::size_t bytes() const { return sizeof(ReplayHeader) + bytes_.size(); }
+
+	bool write(const std::string& file_name) const;
+
+private:
+	GLfloat tick_rate_;
+	bool record_state_;
+	std::uint64_t tick_count_ = 0;
+	std::vector<unsigned char> bytes_;
+
+	// What the last record left things at
+	std::vector<std::uint8_t> inputs_;
+	std::int64_t cursor_x_ = 0, cursor_y_ = 0;
+	GLfloat camera_[3] = {};
+	std::vector<std::uint32_t> state_, steps_;
+};
+
+// Reads a recording straight out of the mapped file, one tick after the other
+class ReplayLog
+{
+public:
+	// 2 moved mouse buttons up by one to make room for GLFW_KEY_LAST
+	static constexpr std::uint32_t version = 2;
+
+	bool open(const std::string& file_name);
+
+	std::uint64_t tick_count() const { return tick_count_; }
+	GLfloat tick_rate() const { return tick_rate_; }
+	bool has_state() const { return has_state_; }
+
+	// Decodes the next tick and pushes its input into Keyboard, Mouse and camera. Returns
+	// false once the log is used up or a record is damaged.
+	bool apply(Camera& camera);
+	// Every tick played, or the rest unreadable
+	bool finished() const { return damaged_ || applied_ >= tick_count_; }
+	std::uint64_t ticks_applied() const { return applied_; }
+
+	// State recorded after the tick apply() last decoded
+	const std::vector<GLfloat>& state() const { return state_; }
+
+private:
+	MappedFile file_;
+	const unsigned char* read_ = nullptr;
+	const unsigned char* end_ = nullptr;
+	std::uint64_t tick_count_ = 0, applied_ = 0;
+	GLfloat tick_rate_ = 60.0f;
+	bool has_state_ = false, damaged_ = false;
+
+	std::vector<std::uint8_t> inputs_;
+	std::int64_t cursor_x_ = 0, cursor_y_ = 0;
+	std::vector<std::uint32_t> words_, steps_;
+	std::vector<GLfloat> state_;
+};
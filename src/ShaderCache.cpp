@@ -0,0 +1,175 @@
+#include "ShaderCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+namespace
+{
+	typedef void (APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei buf_size, GLsizei* length, GLenum* format, void* binary);
+	typedef void (APIENTRYP ProgramBinaryProc)(GLuint program, GLenum format, const void* binary, GLsizei length);
+	typedef void (APIENTRYP ProgramParameteriProc)(GLuint program, GLenum name, GLint value);
+
+	GetProgramBinaryProc get_program_binary = nullptr;
+	ProgramBinaryProc program_binary = nullptr;
+	ProgramParameteriProc program_parameteri = nullptr;
+
+	// Leads every cache file, the format is the driver's binary format enum
+	struct CacheHeader
+	{
+		char magic[4];
+		GLenum format;
+		std::uint64_t key;
+	};
+	const char cache_magic[4] = { 'T', 'E', 'S', 'C' };
+
+	// FNV-1a over the string and its terminator, so "ab" + "c" and "a" + "bc" differ
+	std::uint64_t hash_string(std::uint64_t hash, const char* text)
+	{
+		do
+			hash = (hash ^ static_cast<unsigned char>(*text)) * 1099511628211ull;
+		while (*text++);
+		return hash;
+	}
+
+	bool has_extension(const char* name)
+	{
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint i = 0; i < count; ++i)
+			if (std::strcmp(reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i)), name) == 0)
+				return true;
+		return false;
+	}
+
+	const char* gl_string(GLenum name)
+	{
+		const GLubyte* value = glGetString(name);
+		return value ? reinterpret_cast<const char*>(value) : "";
+	}
+}
+
+bool ShaderCache::enabled_ = false;
+std::string ShaderCache::directory_;
+std::string ShaderCache::driver_;
+
+void ShaderCache::init(GLADloadproc load, const std::string& directory)
+{
+	enabled_ = false;
+	directory_ = directory;
+	driver_ = std::string(gl_string(GL_VENDOR)) + '\n' + gl_string(GL_RENDERER) + '\n' + gl_string(GL_VERSION);
+	if (directory.empty())
+		return;
+
+	// Core since 4.1, which reports the extension as well
+	if (!has_extension("GL_ARB_get_program_binary"))
+	{
+		std::cout << "Shader cache unavailable, no GL_ARB_get_program_binary" << std::endl;
+		return;
+	}
+	get_program_binary = reinterpret_cast<GetProgramBinaryProc>(load("glGetProgramBinary"));
+	program_binary = reinterpret_cast<ProgramBinaryProc>(load("glProgramBinary"));
+	program_parameteri = reinterpret_cast<ProgramParameteriProc>(load("glProgramParameteri"));
+
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	if (!get_program_binary || !program_binary || !program_parameteri || formats == 0)
+	{
+		std::cout << "Shader cache unavailable, the driver has no program binary formats" << std::endl;
+		return;
+	}
+
+#ifdef _WIN32
+	_mkdir(directory.c_str());
+#else
+	mkdir(directory.c_str(), 0755);
+#endif
+	enabled_ = true;
+}
+
+std::uint64_t ShaderCache::key(const GLchar* vs_code, const GLchar* fs_code)
+{
+	std::uint64_t hash = 14695981039346656037ull;
+	hash = hash_string(hash, vs_code);
+	hash = hash_string(hash, fs_code);
+	return hash_string(hash, driver_.c_str());
+}
+
+std::string ShaderCache::file_name(std::uint64_t key)
+{
+	char name[24];
+	std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+	return directory_ + "/" + name;
+}
+
+void ShaderCache::mark_retrievable(GLuint program)
+{
+	if (enabled_)
+		program_parameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+GLuint ShaderCache::load(std::uint64_t key)
+{
+	if (!enabled_)
+		return 0;
+
+	std::ifstream in(file_name(key), std::ios::binary);
+	if (!in)
+		return 0;
+	std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+	CacheHeader header;
+	if (data.size() <= sizeof(header))
+		return 0;
+	std::memcpy(&header, data.data(), sizeof(header));
+	if (std::memcmp(header.magic, cache_magic, 4) != 0 || header.key != key)
+		return 0;
+
+	// Drivers reject binaries from older versions of themselves, that only costs a compile
+	GLuint program = glCreateProgram();
+	program_binary(program, header.format, data.data() + sizeof(header), static_cast<GLsizei>(data.size() - sizeof(header)));
+	GLint success = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		glDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+void ShaderCache::store(std::uint64_t key, GLuint program)
+{
+	if (!enabled_)
+		return;
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	CacheHeader header;
+	std::memcpy(header.magic, cache_magic, 4);
+	header.key = key;
+	std::vector<char> binary(length);
+	get_program_binary(program, length, &length, &header.format, binary.data());
+
+	std::ofstream out(file_name(key), std::ios::binary);
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.write(binary.data(), length);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+
+// Linked program binaries kept on disk, so later launches skip compiling and linking GLSL.
+// A program is keyed on its sources plus the driver's vendor, renderer and version strings,
+// since binaries only load on the driver that produced them. Rejected or unreadable entries
+// are misses, and the caller compiles from source as before.
+class ShaderCache
+{
+public:
+	// glad only loads GL 3.3 core, the ARB_get_program_binary entry points are resolved here.
+	// Without the extension, a binary format or a directory every load() is a miss and
+	// store() does nothing.
+	static void init(GLADloadproc load, const std::string& directory);
+	static bool enabled() { return enabled_; }
+
+	static std::uint64_t key(const GLchar* vs_code, const GLchar* fs_code);
+
+	// Call before linking, drivers may drop what they need for glGetProgramBinary otherwise
+	static void mark_retrievable(GLuint program);
+
+	// A linked program, or 0 on a miss
+	static GLuint load(std::uint64_t key);
+	static void store(std::uint64_t key, GLuint program);
+
+private:
+	static std::string file_name(std::uint64_t key);
+
+	static bool enabled_;
+	static std::string directory_;
+	static std::string driver_;
+};
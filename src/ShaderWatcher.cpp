@@ -0,0 +1,155 @@
+#include "ShaderWatcher.h"
+#include "Profiler.h"
+#include "shader.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+#ifdef __linux__
+	std::string directory_of(const std::string& file_name)
+	{
+		const std::size_t slash = file_name.find_last_of("/\\");
+		return slash == std::string::npos ? "." : file_name.substr(0, slash);
+	}
+#endif
+
+	// Seconds are enough to notice a save, the next one a second later is still caught
+	std::int64_t modified_time(const std::string& file_name)
+	{
+		struct stat info;
+		return stat(file_name.c_str(), &info) == 0 ? static_cast<std::int64_t>(info.st_mtime) : 0;
+	}
+
+#ifndef __linux__
+	// Polling stats every file, a few times a second is plenty while editing
+	constexpr std::uint64_t check_interval = 250000000;
+#endif
+}
+
+ShaderWatcher::ShaderWatcher()
+{
+#ifdef __linux__
+	inotify_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify_ < 0)
+		std::printf("Shader watcher unavailable, inotify_init1 failed\n");
+#endif
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+#ifdef __linux__
+	if (inotify_ >= 0)
+		close(inotify_);
+#endif
+}
+
+void ShaderWatcher::watch(Shader* shader)
+{
+	watch_file(shader->vs_file_name(), shader);
+	watch_file(shader->fs_file_name(), shader);
+}
+
+void ShaderWatcher::watch_file(const std::string& file_name, Shader* shader)
+{
+	auto file = std::find_if(files_.begin(), files_.end(), [&](const WatchedFile& watched) { return watched.file_name == file_name; });
+	if (file == files_.end())
+	{
+		files_.push_back({ file_name, {}, modified_time(file_name), false });
+		file = files_.end() - 1;
+	}
+	file->shaders.push_back(shader);
+
+#ifdef __linux__
+	// One watch per directory, saves through a temporary file replace the watched inode
+	const std::string directory = directory_of(file_name);
+	const bool watched = std::any_of(directories_.begin(), directories_.end(),
+		[&](const std::pair<int, std::string>& entry) { return entry.second == directory; });
+	if (inotify_ >= 0 && !watched)
+	{
+		const int descriptor = inotify_add_watch(inotify_, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+		if (descriptor >= 0)
+			directories_.emplace_back(descriptor, directory);
+	}
+#endif
+}
+
+void ShaderWatcher::find_changes()
+{
+#ifdef __linux__
+	alignas(inotify_event) char buffer[4096];
+	for (;;)
+	{
+		const ssize_t length = inotify_ >= 0 ? read(inotify_, buffer, sizeof(buffer)) : -1;
+		if (length <= 0)
+			break;
+		for (ssize_t offset = 0; offset < length;)
+		{
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+			offset += sizeof(inotify_event) + event->len;
+			if (event->len == 0)
+				continue;
+
+			auto directory = std::find_if(directories_.begin(), directories_.end(),
+				[&](const std::pair<int, std::string>& entry) { return entry.first == event->wd; });
+			if (directory == directories_.end())
+				continue;
+			const std::string file_name = directory->second + "/" + event->name;
+			for (WatchedFile& file : files_)
+				if (file.file_name == file_name)
+					file.changed = true;
+		}
+	}
+#else
+	if (Profiler::now() - last_check_time_ < check_interval)
+		return;
+	last_check_time_ = Profiler::now();
+	for (WatchedFile& file : files_)
+	{
+		const std::int64_t modified = modified_time(file.file_name);
+		if (modified != file.modified)
+		{
+			file.modified = modified;
+			file.changed = true;
+		}
+	}
+#endif
+}
+
+unsigned ShaderWatcher::poll()
+{
+	PROFILE_ZONE("ShaderWatcher::poll");
+	find_changes();
+
+	// A shared vertex shader changing rebuilds every program using it, each program once
+	std::vector<Shader*> dirty;
+	for (WatchedFile& file : files_)
+	{
+		if (!file.changed)
+			continue;
+		file.changed = false;
+		for (Shader* shader : file.shaders)
+			if (std::find(dirty.begin(), dirty.end(), shader) == dirty.end())
+				dirty.push_back(shader);
+	}
+
+	unsigned reloaded = 0;
+	for (Shader* shader : dirty)
+	{
+		const std::uint64_t start = Profiler::now();
+		const bool ok = shader->reload();
+		last_reload_ms_ = (Profiler::now() - start) / 1e6;
+		if (ok)
+			++reloaded;
+		std::printf("%s %s + %s in %.2f ms\n", ok ? "Reloaded" : "Reload failed, keeping the old program for",
+			shader->vs_file_name().c_str(), shader->fs_file_name().c_str(), last_reload_ms_);
+	}
+	return reloaded;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Shader;
+
+// Rebuilds shaders when their source files change on disk, for iterating without a restart.
+// Linux gets change events from inotify on the shader directories, which also catches
+// editors that save through a rename. Elsewhere the files' modification times are polled.
+//
+// Nothing happens off the GL thread: poll() reloads at a frame boundary, and a shader that
+// no longer builds keeps its old program.
+class ShaderWatcher
+{
+public:
+	ShaderWatcher();
+	~ShaderWatcher();
+
+	ShaderWatcher(const ShaderWatcher&) = delete;
+	ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+	// The shader has to outlive the watcher
+	void watch(Shader* shader);
+
+	// Call once per frame before drawing, returns how many shaders were rebuilt
+	unsigned poll();
+
+	// Time the last reload took to read, compile and swap in
+	double last_reload_ms() const { return last_reload_ms_; }
+
+private:
+	struct WatchedFile
+	{
+		std::string file_name;
+		std::vector<Shader*> shaders;
+		std::int64_t modified = 0;
+		bool changed = false;
+	};
+
+	void watch_file(const std::string& file_name, Shader* shader);
+	void find_changes();
+
+	std::vector<WatchedFile> files_;
+	double last_reload_ms_ = 0.0;
+#ifdef __linux__
+	int inotify_ = -1;
+	// inotify watch descriptor and the directory it watches
+	std::vector<std::pair<int, std::string>> directories_;
+#else
+	std::uint64_t last_check_time_ = 0;
+#endif
+};
@@ -0,0 +1,117 @@
+#include "SpatialGrid.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+SpatialGrid::SpatialGrid(GLfloat cell_size)
+	: cell_size_(cell_size), inverse_cell_size_(1.0f / cell_size)
+{
+	assert(cell_size > 0.0f);
+}
+
+std::int32_t SpatialGrid::cell_coordinate(GLfloat value) const
+{
+	// Clamped so far away or non finite positions still land in a cell
+	const GLfloat cell = std::floor(value * inverse_cell_size_);
+	const GLfloat limit = static_cast<GLfloat>(1 << 30);
+	return static_cast<std::int32_t>(std::max(-limit, std::min(limit, std::isnan(cell) ? 0.0f : cell)));
+}
+
+std::uint64_t SpatialGrid::cell_key(std::int32_t x, std::int32_t y) const
+{
+	// Biased so no clamped coordinate pair packs to no_cell, (-1, -1) would otherwise
+	const std::uint32_t bias = 0x80000000u;
+	return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(x) ^ bias) << 32) | (static_cast<std::uint32_t>(y) ^ bias);
+}
+
+void SpatialGrid::update(std::uint32_t id, glm::vec2 center, GLfloat radius)
+{
+	if (id >= items_.size())
+		items_.resize(id + 1);
+
+	Item& item = items_[id];
+	item.center = center;
+	item.radius = radius;
+	max_radius_ = std::max(max_radius_, radius);
+
+	const std::uint64_t cell = cell_key(cell_coordinate(center.x), cell_coordinate(center.y));
+	if (cell == item.cell)
+		return;
+
+	if (item.cell != no_cell)
+		remove(id);
+
+	auto& ids = cells_[cell];
+	item.cell = cell;
+	item.slot = static_cast<std::uint32_t>(ids.size());
+	ids.push_back(id);
+	++size_;
+}
+
+void SpatialGrid::remove(std::uint32_t id)
+{
+	if (!contains(id))
+		return;
+
+	Item& item = items_[id];
+	auto& ids = cells_[item.cell];
+	items_[ids.back()].slot = item.slot;
+	ids[item.slot] = ids.back();
+	ids.pop_back();
+
+	item.cell = no_cell;
+	--size_;
+}
+
+bool SpatialGrid::contains(std::uint32_t id) const
+{
+	return id < items_.size() && items_[id].cell != no_cell;
+}
+
+void SpatialGrid::query_cell(const std::vector<std::uint32_t>& ids, const Bounds& bounds, std::vector<std::uint32_t>& out) const
+{
+	for (std::uint32_t id : ids)
+	{
+		const Item& item = items_[id];
+		const Bounds item_bounds = { item.center - item.radius, item.center + item.radius };
+		if (item_bounds.overlaps(bounds))
+			out.push_back(id);
+	}
+}
+
+void SpatialGrid::query(const Bounds& bounds, std::vector<std::uint32_t>& ids) const
+{
+	// Items are filed by centre, anything reaching into bounds is within max_radius_ of it
+	const Bounds loose = bounds.expanded(max_radius_);
+	const std::int32_t x0 = cell_coordinate(loose.min.x), x1 = cell_coordinate(loose.max.x);
+	const std::int32_t y0 = cell_coordinate(loose.min.y), y1 = cell_coordinate(loose.max.y);
+
+	// Zoomed far out the range covers more cells than exist, walk the occupied ones instead
+	const double range = (static_cast<double>(x1) - x0 + 1) * (static_cast<double>(y1) - y0 + 1);
+	if (range > static_cast<double>(cells_.size()))
+	{
+		for (const auto& cell : cells_)
+			query_cell(cell.second, bounds, ids);
+		return;
+	}
+
+	for (std::int32_t x = x0; x <= x1; ++x)
+	{
+		for (std::int32_t y = y0; y <= y1; ++y)
+		{
+			auto cell = cells_.find(cell_key(x, y));
+			if (cell != cells_.end())
+				query_cell(cell->second, bounds, ids);
+		}
+	}
+}
+
+std::size_t SpatialGrid::memory_bytes() const
+{
+	// A map node holds the key and vector next to its link
+	std::size_t bytes = items_.capacity() * sizeof(Item) + cells_.bucket_count() * sizeof(void*);
+	for (const auto& cell : cells_)
+		bytes += sizeof(cell) + sizeof(void*) + cell.second.capacity() * sizeof(std::uint32_t);
+	return bytes;
+}
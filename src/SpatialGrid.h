@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "affine.h"
+
+// Loose uniform grid over bounding circles. Every item lives in the one cell holding its
+// centre and queries grow by the largest radius seen, so moving an item is a cell lookup
+// and, only when it crosses into another cell, a swap remove plus a push back.
+// Ids are small integers chosen by the caller, storage grows to the largest one.
+class SpatialGrid
+{
+public:
+	explicit SpatialGrid(GLfloat cell_size = 512.0f);
+
+	// Inserts the item or moves it
+	void update(std::uint32_t id, glm::vec2 center, GLfloat radius);
+	void remove(std::uint32_t id);
+	bool contains(std::uint32_t id) const;
+
+	// Appends the ids of items whose bounding box overlaps bounds, in no particular order
+	void query(const Bounds& bounds, std::vector<std::uint32_t>& ids) const;
+
+	std::size_t size() const { return size_; }
+	std::size_t cell_count() const { return cells_.size(); }
+	GLfloat cell_size() const { return cell_size_; }
+	// Heap bytes held, items, cells and the map's nodes and buckets, spare capacity included
+	std::size_t memory_bytes() const;
+
+private:
+	static constexpr std::uint64_t no_cell = ~std::uint64_t(0);
+
+	struct Item
+	{
+		std::uint64_t cell = no_cell;
+		std::uint32_t slot = 0;
+		glm::vec2 center = glm::vec2(0.0f);
+		GLfloat radius = 0.0f;
+	};
+
+	std::int32_t cell_coordinate(GLfloat value) const;
+	std::uint64_t cell_key(std::int32_t x, std::int32_t y) const;
+	void query_cell(const std::vector<std::uint32_t>& ids, const Bounds& bounds, std::vector<std::uint32_t>& out) const;
+
+	GLfloat cell_size_, inverse_cell_size_;
+	GLfloat max_radius_ = 0.0f;
+	std::size_t size_ = 0;
+
+	// Item ids per cell, emptied cells are kept for reuse
+	std::unordered_map<std::uint64_t, std::vector<std::uint32_t>> cells_;
+	std::vector<Item> items_;
+};
@@ -0,0 +1,172 @@
+#include "Terrain.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+void Terrain::add_segment(glm::vec2 a, glm::vec2 b)
+{
+	a_.push_back(a);
+	b_.push_back(b);
+}
+
+void Terrain::add_polyline(const std::vector<glm::vec2>& points)
+{
+	for (std::size_t i = 1; i < points.size(); ++i)
+		add_segment(points[i - 1], points[i]);
+}
+
+void Terrain::add_heightfield(GLfloat x0, GLfloat spacing, const std::vector<GLfloat>& heights)
+{
+	for (std::size_t i = 1; i < heights.size(); ++i)
+		add_segment({ x0 + (i - 1) * spacing, heights[i - 1] }, { x0 + i * spacing, heights[i] });
+}
+
+void Terrain::clear()
+{
+	a_.clear();
+	b_.clear();
+	build(cell_size_);
+}
+
+void Terrain::build(GLfloat cell_size)
+{
+	cell_size_ = cell_size;
+	starts_.clear();
+	indices_.clear();
+	columns_ = rows_ = 0;
+	if (a_.empty())
+		return;
+
+	glm::vec2 low = a_[0], high = a_[0];
+	for (std::size_t i = 0; i < a_.size(); ++i)
+	{
+		low = glm::min(low, glm::min(a_[i], b_[i]));
+		high = glm::max(high, glm::max(a_[i], b_[i]));
+	}
+	origin_ = low;
+	columns_ = static_cast<int>((high.x - low.x) / cell_size_) + 1;
+	rows_ = static_cast<int>((high.y - low.y) / cell_size_) + 1;
+
+	// Counting sort into the cells each segment's bounds touch
+	auto for_each_cell = [this](std::size_t i, auto&& visit)
+	{
+		const glm::vec2 low = glm::min(a_[i], b_[i]), high = glm::max(a_[i], b_[i]);
+		for (int r = row(low.y); r <= row(high.y); ++r)
+			for (int c = column(low.x); c <= column(high.x); ++c)
+				visit(static_cast<std::size_t>(r) * columns_ + c);
+	};
+	starts_.assign(static_cast<std::size_t>(columns_) * rows_ + 1, 0);
+	for (std::size_t i = 0; i < a_.size(); ++i)
+		for_each_cell(i, [this](std::size_t cell) { ++starts_[cell + 1]; });
+	for (std::size_t cell = 1; cell < starts_.size(); ++cell)
+		starts_[cell] += starts_[cell - 1];
+
+	indices_.resize(starts_.back());
+	std::vector<std::uint32_t> cursor(starts_.begin(), starts_.end() - 1);
+	for (std::size_t i = 0; i < a_.size(); ++i)
+		for_each_cell(i, [&](std::size_t cell) { indices_[cursor[cell]++] = static_cast<std::uint32_t>(i); });
+}
+
+int Terrain::column(GLfloat x) const
+{
+	// Clamped just outside the grid before converting, far away queries must not overflow
+	const GLfloat cell = std::min(std::max((x - origin_.x) / cell_size_, -1.0f), static_cast<GLfloat>(columns_));
+	return static_cast<int>(std::floor(cell));
+}
+
+int Terrain::row(GLfloat y) const
+{
+	const GLfloat cell = std::min(std::max((y - origin_.y) / cell_size_, -1.0f), static_cast<GLfloat>(rows_));
+	return static_cast<int>(std::floor(cell));
+}
+
+bool Terrain::highest_point(std::uint32_t i, GLfloat x0, GLfloat x1, GLfloat y_min, glm::vec2& point) const
+{
+	const glm::vec2 a = a_[i], b = b_[i];
+	const GLfloat low = std::min(a.x, b.x), high = std::max(a.x, b.x);
+	if (high < x0 || low > x1)
+		return false;
+
+	// Clip to the span, the highest point is at one end of what is left
+	glm::vec2 p0 = a, p1 = b;
+	if (high > low)
+	{
+		const GLfloat slope = (b.y - a.y) / (b.x - a.x);
+		p0.x = std::max(low, x0);
+		p1.x = std::min(high, x1);
+		p0.y = a.y + (p0.x - a.x) * slope;
+		p1.y = a.y + (p1.x - a.x) * slope;
+	}
+	if (std::max(p0.y, p1.y) < y_min)
+		return false;
+	point = p0.y < p1.y ? p0 : p1;
+	point.y = std::max(point.y, y_min);
+	return true;
+}
+
+glm::vec2 Terrain::normal(std::uint32_t i) const
+{
+	const glm::vec2 d = b_[i] - a_[i];
+	const GLfloat length = glm::length(d);
+	if (length == 0.0f)
+		return { 0.0f, -1.0f };
+	const glm::vec2 n = glm::vec2(d.y, -d.x) / length;
+	return n.y > 0.0f ? -n : n;
+}
+
+bool Terrain::sweep_down(GLfloat x0, GLfloat x1, GLfloat y, GLfloat max_distance, TerrainHit& hit) const
+{
+	if (columns_ == 0)
+		return false;
+	if (x1 < x0)
+		std::swap(x0, x1);
+
+	const int c0 = std::max(column(x0), 0), c1 = std::min(column(x1), columns_ - 1);
+	const GLfloat y_max = y + max_distance;
+	const int r_end = std::min(row(y_max), rows_ - 1);
+
+	glm::vec2 best = { x0, y_max };
+	std::uint32_t best_segment = 0;
+	bool found = false;
+	for (int r = std::max(row(y), 0); r <= r_end; ++r)
+	{
+		for (int c = c0; c <= c1; ++c)
+		{
+			const std::size_t cell = static_cast<std::size_t>(r) * columns_ + c;
+			for (std::uint32_t k = starts_[cell]; k < starts_[cell + 1]; ++k)
+			{
+				glm::vec2 ground;
+				const std::uint32_t i = indices_[k];
+				if (highest_point(i, x0, x1, y, ground) && ground.y <= best.y)
+				{
+					best = ground;
+					best_segment = i;
+					found = true;
+				}
+			}
+		}
+		// A segment sits in every cell its bounds touch, nothing in a lower row can beat a
+		// hit above this row's bottom edge
+		if (found && best.y <= origin_.y + (r + 1) * cell_size_)
+			break;
+	}
+	if (!found)
+		return false;
+
+	hit.point = best;
+	hit.normal = normal(best_segment);
+	hit.segment = best_segment;
+	return true;
+}
+
+bool Terrain::raycast_down(glm::vec2 origin, GLfloat max_distance, TerrainHit& hit) const
+{
+	return sweep_down(origin.x, origin.x, origin.y, max_distance, hit);
+}
+
+void Terrain::raycast_down(const glm::vec2* origins, std::size_t count, GLfloat max_distance, TerrainHit* hits, std::uint8_t* hit) const
+{
+	for (std::size_t i = 0; i < count; ++i)
+		hit[i] = raycast_down(origins[i], max_distance, hits[i]);
+}
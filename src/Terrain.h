@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Where a query met the ground. normal points up, out of the ground.
+struct TerrainHit
+{
+	glm::vec2 point = { 0.0f, 0.0f };
+	glm::vec2 normal = { 0.0f, -1.0f };
+	std::uint32_t segment = 0;
+};
+
+// Ground as a soup of line segments, y grows downwards like everywhere in the game.
+// build() buckets the segments into a uniform grid; a downward query walks one column of
+// cells from the top and stops at the first row that holds a hit, so it only tests the
+// segments near the answer. Unlike SpatialGrid the ground never moves, so the cells are
+// one dense array filled once.
+class Terrain
+{
+public:
+	void add_segment(glm::vec2 a, glm::vec2 b);
+	// Consecutive points joined by segments
+	void add_polyline(const std::vector<glm::vec2>& points);
+	// heights[i] is the ground at x0 + i * spacing
+	void add_heightfield(GLfloat x0, GLfloat spacing, const std::vector<GLfloat>& heights);
+	void clear();
+
+	// Indexes everything added so far, queries only see built segments
+	void build(GLfloat cell_size = 128.0f);
+
+	// Closest ground straight below origin, within max_distance
+	bool raycast_down(glm::vec2 origin, GLfloat max_distance, TerrainHit& hit) const;
+	// Highest ground below the span [x0, x1] at height y, within max_distance: where a foot
+	// that wide comes to rest when lowered. Ground poking above y counts as a hit at y.
+	bool sweep_down(GLfloat x0, GLfloat x1, GLfloat y, GLfloat max_distance, TerrainHit& hit) const;
+	// Many raycast_down at once, hits[i] is only written where hit[i] comes back 1
+	void raycast_down(const glm::vec2* origins, std::size_t count, GLfloat max_distance, TerrainHit* hits, std::uint8_t* hit) const;
+
+	std::size_t segment_count() const { return a_.size(); }
+	glm::vec2 segment_a(std::size_t i) const { return a_[i]; }
+	glm::vec2 segment_b(std::size_t i) const { return b_[i]; }
+	bool empty() const { return a_.empty(); }
+
+private:
+	// Point of segment i over [x0, x1] with the lowest y >= y_min, false if it does not
+	// reach into the span
+	bool highest_point(std::uint32_t i, GLfloat x0, GLfloat x1, GLfloat y_min, glm::vec2& point) const;
+	glm::vec2 normal(std::uint32_t i) const;
+	int column(GLfloat x) const;
+	int row(GLfloat y) const;
+
+	std::vector<glm::vec2> a_, b_;
+
+	// Grid over the bounds of the built segments, cell (column, row) holds
+	// indices_[starts_[row * columns_ + column] .. starts_[... + 1])
+	GLfloat cell_size_ = 128.0f;
+	glm::vec2 origin_ = { 0.0f, 0.0f };
+	int columns_ = 0, rows_ = 0;
+	std::vector<std::uint32_t> starts_, indices_;
+};
@@ -0,0 +1,241 @@
+#include "TextureAtlas.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+#include "stb_image.h"
+
+SkylinePacker::SkylinePacker(GLuint width, GLuint height)
+	: width_(width), height_(height)
+{
+	skyline_.push_back({ 0, 0, width });
+}
+
+bool SkylinePacker::fit(std::size_t index, GLuint width, GLuint height, GLuint& y) const
+{
+	const GLuint x = skyline_[index].x;
+	if (x + width > width_)
+		return false;
+
+	// Resting on the highest segment under its width
+	y = 0;
+	GLuint covered = 0;
+	for (std::size_t i = index; covered < width; ++i)
+	{
+		y = std::max(y, skyline_[i].y);
+		covered += skyline_[i].width;
+	}
+	return y + height <= height_;
+}
+
+bool SkylinePacker::pack(GLuint width, GLuint height, GLuint& x, GLuint& y)
+{
+	// Lowest top edge wins, narrower segments break ties so wide gaps stay open
+	std::size_t best = skyline_.size();
+	GLuint best_top = std::numeric_limits<GLuint>::max();
+	GLuint best_width = std::numeric_limits<GLuint>::max();
+	for (std::size_t i = 0; i < skyline_.size(); ++i)
+	{
+		GLuint top;
+		if (!fit(i, width, height, top))
+			continue;
+		top += height;
+		if (top < best_top || (top == best_top && skyline_[i].width < best_width))
+		{
+			best = i;
+			best_top = top;
+			best_width = skyline_[i].width;
+		}
+	}
+	if (best == skyline_.size())
+		return false;
+
+	x = skyline_[best].x;
+	y = best_top - height;
+
+	// New segment on top of the rect, then trim the segments it now covers
+	skyline_.insert(skyline_.begin() + best, { x, best_top, width });
+	const GLuint right = x + width;
+	std::size_t i = best + 1;
+	while (i < skyline_.size() && skyline_[i].x < right)
+	{
+		const GLuint end = skyline_[i].x + skyline_[i].width;
+		if (end <= right)
+		{
+			skyline_.erase(skyline_.begin() + i);
+			continue;
+		}
+		skyline_[i].width = end - right;
+		skyline_[i].x = right;
+		break;
+	}
+
+	// Merge neighbours at the same height
+	for (std::size_t j = 0; j + 1 < skyline_.size();)
+	{
+		if (skyline_[j].y == skyline_[j + 1].y)
+		{
+			skyline_[j].width += skyline_[j + 1].width;
+			skyline_.erase(skyline_.begin() + j + 1);
+		}
+		else
+			++j;
+	}
+
+	used_area_ += static_cast<std::size_t>(width) * height;
+	return true;
+}
+
+TextureAtlas::TextureAtlas(GLuint page_size, GLuint padding)
+	: page_size_(page_size), padding_(padding)
+{
+}
+
+void TextureAtlas::add(const std::string& name, const std::string& file_name)
+{
+	Image image;
+	image.name = name;
+	image.file_name = file_name;
+	queued_.push_back(std::move(image));
+}
+
+void TextureAtlas::add(const std::string& name, GLuint width, GLuint height, std::vector<unsigned char> pixels)
+{
+	Image image;
+	image.name = name;
+	image.width = width;
+	image.height = height;
+	image.pixels = std::move(pixels);
+	queued_.push_back(std::move(image));
+}
+
+void TextureAtlas::build(JobSystem* jobs)
+{
+	PROFILE_ZONE("TextureAtlas::build");
+
+	auto decode = [this](std::size_t begin, std::size_t end)
+	{
+		for (std::size_t i = begin; i < end; ++i)
+		{
+			Image& image = queued_[i];
+			if (image.file_name.empty())
+				continue;
+			int width = 0, height = 0, channels = 0;
+			unsigned char* pixels = stbi_load(image.file_name.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+			if (!pixels)
+				continue;
+			image.width = width;
+			image.height = height;
+			image.pixels.assign(pixels, pixels + static_cast<std::size_t>(width) * height * 4);
+			stbi_image_free(pixels);
+		}
+	};
+	if (jobs)
+		jobs->parallel_for(queued_.size(), 1, decode);
+	else
+		decode(0, queued_.size());
+
+	// Tallest first keeps the skyline flat
+	std::vector<std::size_t> order;
+	for (std::size_t i = 0; i < queued_.size(); ++i)
+	{
+		const Image& image = queued_[i];
+		if (image.pixels.empty())
+			std::cout << "Failed to load atlas image: " << image.name << " " << image.file_name << std::endl;
+		else if (image.width + 2 * padding_ > page_size_ || image.height + 2 * padding_ > page_size_)
+			std::cout << "Atlas image larger than a page: " << image.name << std::endl;
+		else
+			order.push_back(i);
+	}
+	std::stable_sort(order.begin(), order.end(), [this](std::size_t a, std::size_t b)
+	{
+		return queued_[a].height != queued_[b].height ? queued_[a].height > queued_[b].height : queued_[a].width > queued_[b].width;
+	});
+
+	struct Placement
+	{
+		std::size_t image, page;
+		GLuint x, y;
+	};
+	std::vector<SkylinePacker> packers;
+	std::vector<Placement> placements;
+	std::vector<GLuint> page_heights;
+	for (std::size_t i : order)
+	{
+		const GLuint width = queued_[i].width + 2 * padding_;
+		const GLuint height = queued_[i].height + 2 * padding_;
+
+		Placement placement{ i, 0, 0, 0 };
+		while (placement.page < packers.size() && !packers[placement.page].pack(width, height, placement.x, placement.y))
+			++placement.page;
+		if (placement.page == packers.size())
+		{
+			packers.emplace_back(page_size_, page_size_);
+			page_heights.push_back(0);
+			packers.back().pack(width, height, placement.x, placement.y);
+		}
+		page_heights[placement.page] = std::max(page_heights[placement.page], placement.y + height);
+		placements.push_back(placement);
+	}
+
+	// Pages are only as tall as their content
+	const std::size_t first_page = pages_.size();
+	std::vector<std::vector<unsigned char>> page_pixels(packers.size());
+	for (std::size_t page = 0; page < packers.size(); ++page)
+		page_pixels[page].assign(static_cast<std::size_t>(page_size_) * page_heights[page] * 4, 0);
+
+	for (const Placement& placement : placements)
+	{
+		const Image& image = queued_[placement.image];
+		unsigned char* destination = page_pixels[placement.page].data();
+		const std::size_t page_stride = static_cast<std::size_t>(page_size_) * 4;
+
+		// Every padded row copies its clamped source row, with the edge pixels extruded sideways
+		for (GLuint row = 0; row < image.height + 2 * padding_; ++row)
+		{
+			const GLuint source_row = std::min(std::max(row, padding_) - padding_, image.height - 1);
+			const unsigned char* source = image.pixels.data() + static_cast<std::size_t>(source_row) * image.width * 4;
+			unsigned char* out = destination + (placement.y + row) * page_stride + static_cast<std::size_t>(placement.x) * 4;
+
+			for (GLuint column = 0; column < padding_; ++column)
+				std::memcpy(out + column * 4, source, 4);
+			std::memcpy(out + padding_ * 4, source, static_cast<std::size_t>(image.width) * 4);
+			for (GLuint column = 0; column < padding_; ++column)
+				std::memcpy(out + (padding_ + image.width + column) * 4, source + (image.width - 1) * 4, 4);
+		}
+
+		AtlasRegion region;
+		region.name = image.name;
+		region.width = image.width;
+		region.height = image.height;
+		region.uv = glm::vec4(placement.x + padding_, placement.y + padding_,
+		                      placement.x + padding_ + image.width, placement.y + padding_ + image.height)
+			/ glm::vec4(page_size_, page_heights[placement.page], page_size_, page_heights[placement.page]);
+		region.texture = nullptr;
+		regions_.push_back(region);
+	}
+
+	for (std::size_t page = 0; page < packers.size(); ++page)
+	{
+		pages_.push_back(std::make_unique<Texture>());
+		pages_.back()->allocate(page_size_, page_heights[page]);
+		pages_.back()->upload_rows(0, page_heights[page], page_pixels[page].data());
+		pages_.back()->finish_upload();
+	}
+	for (std::size_t i = 0; i < placements.size(); ++i)
+		regions_[regions_.size() - placements.size() + i].texture = pages_[first_page + placements[i].page].get();
+
+	queued_.clear();
+}
+
+const AtlasRegion* TextureAtlas::find(const std::string& name) const
+{
+	for (const auto& region : regions_)
+		if (region.name == name)
+			return &region;
+	return nullptr;
+}
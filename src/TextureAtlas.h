@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "texture.h"
+
+class JobSystem;
+
+// Skyline bottom-left rectangle packer. The skyline is the top edge of everything placed so
+// far as a list of horizontal segments; a rect goes where its top ends up lowest.
+class SkylinePacker
+{
+public:
+	SkylinePacker(GLuint width, GLuint height);
+
+	// False when the rect no longer fits
+	bool pack(GLuint width, GLuint height, GLuint& x, GLuint& y);
+
+	GLuint width() const { return width_; }
+	GLuint height() const { return height_; }
+	// Pixels covered by packed rects
+	std::size_t used_area() const { return used_area_; }
+
+private:
+	struct Segment
+	{
+		GLuint x, y, width;
+	};
+
+	// Lowest y a rect of this width can sit at starting on segment index, false if it runs off the edge
+	bool fit(std::size_t index, GLuint width, GLuint height, GLuint& y) const;
+
+	GLuint width_, height_;
+	std::size_t used_area_ = 0;
+	std::vector<Segment> skyline_;
+};
+
+// Where an image ended up, uv is (u0, v0, u1, v1) into page
+struct AtlasRegion
+{
+	std::string name;
+	Texture* texture = nullptr;
+	glm::vec4 uv = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+	GLuint width = 0, height = 0;
+};
+
+// Packs many images into as few page textures as possible at load time, so sprites drawing
+// different images share a texture and the batchers draw them in one call. Sprites pick their
+// image through Drawable::uv_rect.
+class TextureAtlas
+{
+public:
+	// Pages are page_size squared. padding pixels around every image repeat its edge, so
+	// filtering never pulls in a neighbour.
+	explicit TextureAtlas(GLuint page_size = 2048, GLuint padding = 1);
+
+	// Queue an image, decoded and packed by build()
+	void add(const std::string& name, const std::string& file_name);
+	// Queue decoded RGBA8 pixels
+	void add(const std::string& name, GLuint width, GLuint height, std::vector<unsigned char> pixels);
+
+	// Decodes queued files, over jobs when given, packs tallest first and uploads the pages.
+	// Images that fail to decode or don't fit on a page are reported and skipped. Calling it
+	// again packs the newly queued images onto new pages.
+	void build(JobSystem* jobs = nullptr);
+
+	// nullptr if no image had that name
+	const AtlasRegion* find(const std::string& name) const;
+
+	const std::vector<AtlasRegion>& regions() const { return regions_; }
+	std::size_t page_count() const { return pages_.size(); }
+	Texture* page(std::size_t index) const { return pages_[index].get(); }
+
+private:
+	struct Image
+	{
+		std::string name, file_name;
+		GLuint width = 0, height = 0;
+		std::vector<unsigned char> pixels;
+	};
+
+	GLuint page_size_, padding_;
+	std::vector<Image> queued_;
+	std::vector<AtlasRegion> regions_;
+	std::vector<std::unique_ptr<Texture>> pages_;
+};
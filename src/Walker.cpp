@@ -0,0 +1,341 @@
+#include "Walker.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include "Terrain.h"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/constants.hpp>
+
+namespace
+{
+	// Walkers per job when stepping, legs per job when solving
+	constexpr std::size_t walker_batch = 64;
+	constexpr std::size_t leg_batch = 1024;
+	// How quickly a body settles to its ride height over terrain, per second
+	constexpr GLfloat body_settle = 10.0f;
+
+	GLfloat fract(GLfloat value)
+	{
+		return value - std::floor(value);
+	}
+}
+
+WalkerDesc WalkerDesc::make(unsigned leg_count, GLfloat leg_length, GLfloat body_width, Gait gait)
+{
+	WalkerDesc desc;
+	desc.legs.resize(leg_count);
+	for (unsigned i = 0; i < leg_count; ++i)
+	{
+		LegDesc& leg = desc.legs[i];
+		leg.hip_offset.x = leg_count > 1 ? body_width * (static_cast<GLfloat>(i) / (leg_count - 1) - 0.5f) : 0.0f;
+		leg.upper_length = leg.lower_length = leg_length;
+	}
+	desc.step_size = leg_length;
+	desc.set_gait(gait);
+	return desc;
+}
+
+void WalkerDesc::set_gait(Gait gait)
+{
+	const unsigned count = static_cast<unsigned>(legs.size());
+	// Legs alternate between the two sides, for ripple
+	const unsigned per_side = (count + 1) / 2;
+	for (unsigned i = 0; i < count; ++i)
+	{
+		LegDesc& leg = legs[i];
+		switch (gait)
+		{
+		case Gait::tripod:
+			leg.phase_offset = (i % 2) * 0.5f;
+			leg.duty_factor = 0.5f;
+			break;
+		case Gait::wave:
+			leg.phase_offset = static_cast<GLfloat>(i) / count;
+			leg.duty_factor = count > 1 ? 1.0f - 1.0f / count : 0.5f;
+			break;
+		case Gait::ripple:
+			leg.phase_offset = fract(static_cast<GLfloat>(i / 2) / per_side + (i % 2) * 0.5f);
+			leg.duty_factor = std::max(0.5f, 1.0f - 1.0f / per_side);
+			break;
+		}
+	}
+}
+
+std::size_t WalkerRig::add(const WalkerDesc& desc, glm::vec2 position, GLfloat ground_y)
+{
+	// The cycle is long enough for the leg that stands longest to fit its swing in
+	GLfloat duty = 0.0f, reach = 0.0f;
+	for (const LegDesc& leg : desc.legs)
+	{
+		duty = std::max(duty, leg.duty_factor);
+		reach = std::max(reach, leg.upper_length + leg.lower_length);
+	}
+
+	const std::size_t walker = position_.size();
+	position_.push_back(position);
+	direction_.push_back({ 0.0f, 0.0f });
+	ground_normal_.push_back({ 0.0f, -1.0f });
+	phase_.push_back(0.0f);
+	cycle_time_.push_back(desc.swing_time / (1.0f - std::min(duty, 0.95f)));
+	speed_.push_back(desc.speed);
+	swing_time_.push_back(desc.swing_time);
+	step_height_.push_back(desc.step_height);
+	step_size_.push_back(desc.step_size);
+	ground_y_.push_back(ground_y);
+	ride_height_.push_back(ground_y - position.y);
+	reach_.push_back(reach);
+	stretch_.push_back(desc.stretch * desc.step_size);
+	foot_width_.push_back(desc.foot_width);
+	facing_right_.push_back(1);
+	predict_.push_back(desc.predict ? 1 : 0);
+	first_leg_.push_back(static_cast<std::uint32_t>(legs_.size()));
+	leg_end_.push_back(static_cast<std::uint32_t>(legs_.size() + desc.legs.size()));
+
+	const std::size_t first = legs_.size();
+	legs_.resize(first + desc.legs.size());
+	for (std::size_t i = 0; i < desc.legs.size(); ++i)
+	{
+		const LegDesc& leg = desc.legs[i];
+		const glm::vec2 hip = position + leg.hip_offset;
+		const GLfloat foot_y = foot_ground(walker, hip.x, hip, leg.upper_length + leg.lower_length);
+		hip_x_.push_back(leg.hip_offset.x);
+		hip_y_.push_back(leg.hip_offset.y);
+		phase_offset_.push_back(leg.phase_offset);
+		duty_factor_.push_back(leg.duty_factor);
+		foot_x_.push_back(hip.x);
+		foot_y_.push_back(foot_y);
+		start_x_.push_back(hip.x);
+		start_y_.push_back(foot_y);
+		target_x_.push_back(hip.x);
+		target_y_.push_back(foot_y);
+		swing_elapsed_.push_back(0.0f);
+		swinging_.push_back(0);
+		legs_.set_leg(first + i, leg.upper_length, leg.lower_length, hip, { hip.x, foot_y }, true);
+	}
+	solve_legs(first, legs_.size());
+
+	return walker;
+}
+
+void WalkerRig::clear()
+{
+	for (auto* values : { &position_, &direction_, &ground_normal_ })
+		values->clear();
+	for (auto* values : { &phase_, &cycle_time_, &speed_, &swing_time_, &step_height_, &step_size_, &ground_y_,
+	                      &ride_height_, &reach_, &stretch_, &foot_width_, &hip_x_, &hip_y_, &phase_offset_, &duty_factor_, &foot_x_, &foot_y_, &start_x_, &start_y_,
+	                      &target_x_, &target_y_, &swing_elapsed_ })
+		values->clear();
+	for (auto* values : { &facing_right_, &predict_, &swinging_ })
+		values->clear();
+	first_leg_.clear();
+	leg_end_.clear();
+	legs_.resize(0);
+}
+
+GLfloat WalkerRig::foot_ground(std::size_t walker, GLfloat x, glm::vec2 hip, GLfloat reach) const
+{
+	if (!terrain_)
+		return ground_y_[walker];
+
+	// From the hip down as far as ride_terrain looks, ground above the hip belongs to the
+	// row of terrain stacked over this one
+	TerrainHit hit;
+	const GLfloat half_width = foot_width_[walker] * 0.5f;
+	if (terrain_->sweep_down(x - half_width, x + half_width, hip.y, ride_height_[walker] + reach, hit))
+		return hit.point.y;
+	return hip.y + reach;
+}
+
+void WalkerRig::ride_terrain(std::size_t begin, std::size_t end, GLfloat dt)
+{
+	glm::vec2 origins[walker_batch];
+	TerrainHit hits[walker_batch];
+	std::uint8_t hit[walker_batch];
+
+	const GLfloat settle = std::min(dt * body_settle, 1.0f);
+	for (std::size_t chunk = begin; chunk < end; chunk += walker_batch)
+	{
+		const std::size_t count = std::min(end - chunk, walker_batch);
+		// From the body down to where its legs give out, so a walker never finds ground
+		// above it
+		GLfloat distance = 0.0f;
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const std::size_t w = chunk + i;
+			origins[i] = position_[w];
+			distance = std::max(distance, ride_height_[w] + reach_[w]);
+		}
+		terrain_->raycast_down(origins, count, distance, hits, hit);
+
+		// Walkers off the terrain keep to the last ground they had
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const std::size_t w = chunk + i;
+			if (hit[i] && hits[i].point.y <= position_[w].y + ride_height_[w] + reach_[w])
+			{
+				ground_y_[w] = hits[i].point.y;
+				ground_normal_[w] = hits[i].normal;
+			}
+			position_[w].y += (ground_y_[w] - ride_height_[w] - position_[w].y) * settle;
+		}
+	}
+}
+
+void WalkerRig::step_walkers(std::size_t begin, std::size_t end, GLfloat dt)
+{
+	for (std::size_t w = begin; w < end; ++w)
+	{
+		const glm::vec2 direction = direction_[w];
+		if (direction.x != 0.0f)
+			facing_right_[w] = direction.x > 0.0f;
+		// Over terrain up and down raise and lower the body instead
+		if (!terrain_)
+		{
+			position_[w] += direction * speed_[w] * dt;
+			continue;
+		}
+		position_[w].x += direction.x * speed_[w] * dt;
+		ride_height_[w] = std::max(ride_height_[w] - direction.y * speed_[w] * dt, 0.0f);
+	}
+	if (terrain_)
+		ride_terrain(begin, end, dt);
+
+	for (std::size_t w = begin; w < end; ++w)
+	{
+		const glm::vec2 direction = direction_[w];
+		const bool moving = direction.x != 0.0f || direction.y != 0.0f;
+		const GLfloat velocity_x = direction.x * speed_[w];
+
+		// Past the speed where a foot would stand for more than two step sizes of ground,
+		// the cycle and the swings run faster instead of the legs trailing behind
+		const GLfloat stance_time = cycle_time_[w] - swing_time_[w];
+		const GLfloat cadence = predict_[w] ? std::max(1.0f, std::abs(velocity_x) * stance_time / (2.0f * step_size_[w])) : 1.0f;
+
+		// The clock only runs while moving, a walker standing still keeps its feet down
+		const GLfloat advance = moving ? dt * cadence / cycle_time_[w] : 0.0f;
+		const GLfloat previous_phase = phase_[w];
+		phase_[w] = fract(previous_phase + advance);
+
+		const glm::vec2 position = position_[w];
+		const GLfloat facing = facing_right_[w] ? 1.0f : -1.0f;
+		// Along the ground in the facing direction, steps are measured on the slope
+		const glm::vec2 normal = ground_normal_[w];
+		const glm::vec2 along = glm::vec2(-normal.y, normal.x) * facing;
+		for (std::uint32_t leg = first_leg_[w]; leg < leg_end_[w]; ++leg)
+		{
+			const glm::vec2 hip = position + glm::vec2(hip_x_[leg], hip_y_[leg]);
+
+			if (!swinging_[leg] && moving)
+			{
+				// Lift off when this tick carries the leg's phase into its swing window
+				GLfloat to_window = duty_factor_[leg] - fract(previous_phase + phase_offset_[leg]);
+				if (to_window < 0.0f)
+					to_window += 1.0f;
+				// or when the foot has fallen too far behind, from the ground under the hip
+				const glm::vec2 from_hip = glm::vec2(foot_x_[leg] - hip.x, foot_y_[leg] - ground_y_[w]);
+				if (to_window <= advance || std::abs(glm::dot(from_hip, along)) > stretch_[w])
+				{
+					swinging_[leg] = 1;
+					swing_elapsed_[leg] = 0.0f;
+					start_x_[leg] = foot_x_[leg];
+					start_y_[leg] = foot_y_[leg];
+				}
+			}
+
+			if (swinging_[leg])
+			{
+				// A step ahead of where the hip will be on landing, arcing up on the way. Re-aimed
+				// every tick, so it holds still at a steady speed and follows turns.
+				swing_elapsed_[leg] += dt * cadence;
+				const GLfloat t = std::min(swing_elapsed_[leg] / swing_time_[w], 1.0f);
+				const GLfloat time_left = predict_[w] ? (swing_time_[w] - swing_elapsed_[leg]) / cadence : 0.0f;
+				target_x_[leg] = hip.x + velocity_x * std::max(time_left, 0.0f) + along.x * step_size_[w];
+				target_y_[leg] = foot_ground(w, target_x_[leg], hip, legs_.l1[leg] + legs_.l2[leg]);
+				foot_x_[leg] = start_x_[leg] + (target_x_[leg] - start_x_[leg]) * t;
+				foot_y_[leg] = start_y_[leg] + (target_y_[leg] - start_y_[leg]) * t - std::sin(t * glm::pi<GLfloat>()) * step_height_[w];
+				if (t >= 1.0f)
+					swinging_[leg] = 0;
+			}
+
+			legs_.base_x[leg] = hip.x;
+			legs_.base_y[leg] = hip.y;
+			legs_.target_x[leg] = foot_x_[leg];
+			legs_.target_y[leg] = foot_y_[leg];
+			legs_.flip_direction[leg] = facing_right_[w];
+		}
+	}
+}
+
+void WalkerRig::update(GLfloat dt, JobSystem* jobs)
+{
+	PROFILE_ZONE("WalkerRig::update");
+	step(dt, jobs);
+	solve(jobs);
+}
+
+void WalkerRig::step(GLfloat dt, JobSystem* jobs)
+{
+	PROFILE_ZONE("WalkerRig::step");
+	if (!jobs)
+	{
+		step_walkers(0, walker_count(), dt);
+		return;
+	}
+
+	jobs->parallel_for(walker_count(), walker_batch, [&](std::size_t begin, std::size_t end)
+	{
+		step_walkers(begin, end, dt);
+	});
+}
+
+void WalkerRig::solve(JobSystem* jobs)
+{
+	PROFILE_ZONE("WalkerRig::solve");
+	if (!jobs)
+	{
+		legs_.solve();
+		return;
+	}
+
+	// Every leg of every walker in one batch
+	jobs->parallel_for(legs_.size(), leg_batch, [&](std::size_t begin, std::size_t end)
+	{
+		PROFILE_ZONE("IKSolverBatch::solve");
+		solve_legs(begin, end);
+	});
+}
+
+void WalkerRig::solve_legs(std::size_t begin, std::size_t end)
+{
+	const IKBatchInput in = legs_.input();
+	const IKBatchOutput out = legs_.output();
+	const IKBatchInput range_in = { in.base_x + begin, in.base_y + begin, in.target_x + begin, in.target_y + begin,
+	                                in.l1 + begin, in.l2 + begin, in.flip_direction + begin, end - begin };
+	const IKBatchOutput range_out = { out.first_x + begin, out.first_y + begin, out.second_x + begin, out.second_y + begin,
+	                                  out.last_x + begin, out.last_y + begin, out.angle1 + begin, out.angle2 + begin };
+	IKSolverBatch::solve(range_in, range_out);
+}
+
+void WalkerRig::snapshot(std::vector<GLfloat>& state) const
+{
+	for (const auto* values : { &position_, &direction_, &ground_normal_ })
+		for (glm::vec2 value : *values)
+			state.insert(state.end(), { value.x, value.y });
+	for (const auto* values : { &phase_, &ground_y_, &ride_height_, &foot_x_, &foot_y_, &start_x_, &start_y_,
+	                            &target_x_, &target_y_, &swing_elapsed_, &legs_.angle1, &legs_.angle2 })
+		state.insert(state.end(), values->begin(), values->end());
+	for (const auto* values : { &facing_right_, &swinging_ })
+		state.insert(state.end(), values->begin(), values->end());
+}
+
+std::size_t WalkerRig::memory_bytes() const
+{
+	std::size_t bytes = (position_.capacity() + direction_.capacity() + ground_normal_.capacity()) * sizeof(glm::vec2)
+		+ (facing_right_.capacity() + predict_.capacity() + swinging_.capacity()) + (first_leg_.capacity() + leg_end_.capacity()) * sizeof(std::uint32_t);
+	for (const auto* values : { &phase_, &cycle_time_, &speed_, &swing_time_, &step_height_, &step_size_, &ground_y_,
+	                            &ride_height_, &reach_, &stretch_, &foot_width_, &hip_x_, &hip_y_, &phase_offset_, &duty_factor_, &foot_x_, &foot_y_, &start_x_, &start_y_,
+	                            &target_x_, &target_y_, &swing_elapsed_ })
+		bytes += values->capacity() * sizeof(GLfloat);
+	return bytes + legs_.memory_bytes();
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "IKSolverBatch.h"
+
+class JobSystem;
+class Terrain;
+
+// Leg timing patterns. Every leg lifts once per cycle, for the fraction of it the duty
+// factor leaves off the ground.
+enum class Gait
+{
+	// Alternate legs lift together, half the legs are always down
+	tripod,
+	// One leg at a time, front to back, the slowest and most stable
+	wave,
+	// Each side runs a wave half a cycle apart from the other, two legs in the air at a time
+	ripple,
+};
+
+struct LegDesc
+{
+	// Hip relative to the walker's root
+	glm::vec2 hip_offset = { 0.0f, 0.0f };
+	GLfloat upper_length = 200.0f, lower_length = 200.0f;
+	// Where in the cycle the leg's swing starts, and the part of the cycle it stands
+	GLfloat phase_offset = 0.0f;
+	GLfloat duty_factor = 0.5f;
+};
+
+// Everything that defines a kind of walker, shared by every instance of it
+struct WalkerDesc
+{
+	std::vector<LegDesc> legs;
+	// Root speed while a direction is held, in units per second
+	GLfloat speed = 600.0f;
+	// Seconds a foot spends in the air, and how high it lifts
+	GLfloat swing_time = 0.5f;
+	GLfloat step_height = 40.0f;
+	// How far ahead of its hip a foot lands, measured along the ground
+	GLfloat step_size = 200.0f;
+	// A planted foot further than this many step sizes from its hip, along the ground,
+	// steps right away instead of waiting for its turn
+	GLfloat stretch = 2.0f;
+	// Feet rest on the highest ground under this width, so they do not sink into cracks
+	GLfloat foot_width = 20.0f;
+	// Aim each step at where the hip will be when the foot lands, and quicken the cadence
+	// once a stance would cover more than two step sizes. Off, a swinging foot chases a spot
+	// ahead of the hip at a fixed cadence and fast walkers trail their legs.
+	bool predict = true;
+
+	// legs evenly spread over body_width, phases and duty factors from gait
+	static WalkerDesc make(unsigned leg_count, GLfloat leg_length, GLfloat body_width, Gait gait);
+	// Rewrites every leg's phase offset and duty factor
+	void set_gait(Gait gait);
+};
+
+// Any number of walkers with any number of legs. Walker and leg state live in flat arrays,
+// the legs of one walker next to each other, and all legs are solved as one IK batch.
+//
+// A phase clock per walker runs while it moves and decides when each leg lifts; the swing
+// itself runs on the leg's own timer, so any number of legs can be in the air at once.
+//
+// Without terrain every walker keeps to its flat ground_y. With terrain the body rides at
+// its starting height above the ground under it, and feet land where a sweep down from the
+// step target meets the ground.
+class WalkerRig
+{
+public:
+	// Returns the walker index. Feet start planted below their hips on the ground, ground_y
+	// when there is no terrain under them.
+	std::size_t add(const WalkerDesc& desc, glm::vec2 position, GLfloat ground_y);
+	void clear();
+
+	// Has to outlive the rig or be reset, nullptr walks on flat ground again
+	void set_terrain(const Terrain* terrain) { terrain_ = terrain; }
+
+	// Held direction, zero to stand still. Feet in the air finish their step.
+	void set_direction(std::size_t walker, glm::vec2 direction) { direction_[walker] = direction; }
+
+	// Moves the walkers, schedules and animates steps and solves every leg. update() runs
+	// step() then solve(), they are separate for timing them.
+	void update(GLfloat dt, JobSystem* jobs = nullptr);
+	void step(GLfloat dt, JobSystem* jobs = nullptr);
+	void solve(JobSystem* jobs = nullptr);
+
+	// Heap bytes held by the rig
+	std::size_t memory_bytes() const;
+	// Appends everything that changes while walking, for recording and comparing runs
+	void snapshot(std::vector<GLfloat>& state) const;
+
+	std::size_t walker_count() const { return position_.size(); }
+	std::size_t leg_count() const { return legs_.size(); }
+
+	glm::vec2 position(std::size_t walker) const { return position_[walker]; }
+	glm::vec2 direction(std::size_t walker) const { return direction_[walker]; }
+	bool facing_right(std::size_t walker) const { return facing_right_[walker] != 0; }
+	GLfloat phase(std::size_t walker) const { return phase_[walker]; }
+	// Ground under the root as of the last step, and which way is up there
+	GLfloat ground_y(std::size_t walker) const { return ground_y_[walker]; }
+	glm::vec2 ground_normal(std::size_t walker) const { return ground_normal_[walker]; }
+
+	// Legs of a walker are [first_leg, first_leg + legs)
+	std::size_t first_leg(std::size_t walker) const { return first_leg_[walker]; }
+	std::size_t legs(std::size_t walker) const { return leg_end_[walker] - first_leg_[walker]; }
+
+	bool swinging(std::size_t leg) const { return swinging_[leg] != 0; }
+	glm::vec2 foot(std::size_t leg) const { return { foot_x_[leg], foot_y_[leg] }; }
+	// Solved joints and angles of every leg
+	const IKSolverBatch& solved() const { return legs_; }
+
+private:
+	// Walkers [begin, end), everything but the IK solve
+	void step_walkers(std::size_t begin, std::size_t end, GLfloat dt);
+	// Moves the bodies of walkers [begin, end) over the terrain
+	void ride_terrain(std::size_t begin, std::size_t end, GLfloat dt);
+	// Where a foot aimed at x comes down, hip.y plus the reach when there is no ground
+	GLfloat foot_ground(std::size_t walker, GLfloat x, glm::vec2 hip, GLfloat reach) const;
+	void solve_legs(std::size_t begin, std::size_t end);
+
+	const Terrain* terrain_ = nullptr;
+
+	// Per walker
+	std::vector<glm::vec2> position_, direction_, ground_normal_;
+	std::vector<GLfloat> phase_, cycle_time_, speed_, swing_time_, step_height_, step_size_, ground_y_;
+	std::vector<GLfloat> ride_height_, reach_, stretch_, foot_width_;
+	std::vector<std::uint8_t> facing_right_, predict_;
+	std::vector<std::uint32_t> first_leg_, leg_end_;
+
+	// Per leg
+	std::vector<GLfloat> hip_x_, hip_y_, phase_offset_, duty_factor_;
+	std::vector<GLfloat> foot_x_, foot_y_, start_x_, start_y_, target_x_, target_y_, swing_elapsed_;
+	std::vector<std::uint8_t> swinging_;
+	IKSolverBatch legs_;
+};
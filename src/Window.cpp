@@ -37,7 +37,7 @@ void Window::init(const char* name, GLuint width, GLuint height)
 	// Create OpenGL Context
 	glfwMakeContextCurrent(window_);
 	gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
-	glfwSwapInterval(2);
+	glfwSwapInterval(1);
 
 	// normalize window to work on other devices
 	glViewport(0, 0, width, height);
@@ -76,6 +76,11 @@ void Window::update()
 	glfwSwapBuffers(window_);
 }
 
+void Window::set_title(const std::string& title)
+{
+	glfwSetWindowTitle(window_, title.c_str());
+}
+
 bool Window::is_open()
 {
 	 return (!glfwWindowShouldClose(window_));
@@ -1,5 +1,6 @@
 #pragma once
 #include <bitset>
+#include <string>
 #include <glad/glad.h>
 #include <glfw3.h>
 #include <glm/vec3.hpp>
@@ -16,6 +17,7 @@ public:
 	void update();
 	void process_events();
 	bool is_open();
+	void set_title(const std::string& title);
 
 	GLuint width, height;
 private:
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cmath>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Axis aligned box, min inclusive
+struct Bounds
+{
+	glm::vec2 min = glm::vec2(0.0f);
+	glm::vec2 max = glm::vec2(0.0f);
+
+	bool overlaps(const Bounds& other) const
+	{
+		return min.x <= other.max.x && other.min.x <= max.x && min.y <= other.max.y && other.min.y <= max.y;
+	}
+
+	Bounds expanded(GLfloat amount) const
+	{
+		return { min - amount, max + amount };
+	}
+};
+
+// 2D affine transform, the top two rows of a 3x3 matrix:
+//   | a  c  tx |
+//   | b  d  ty |
+// Everything on the CPU side stays in this form, to_mat4() is for the GPU upload only.
+struct Affine2
+{
+	GLfloat a = 1.0f, b = 0.0f;
+	GLfloat c = 0.0f, d = 1.0f;
+	GLfloat tx = 0.0f, ty = 0.0f;
+
+	static Affine2 translation(glm::vec2 t)
+	{
+		return { 1.0f, 0.0f, 0.0f, 1.0f, t.x, t.y };
+	}
+
+	static Affine2 scaling(glm::vec2 s)
+	{
+		return { s.x, 0.0f, 0.0f, s.y, 0.0f, 0.0f };
+	}
+
+	// translate(position) * rotate(rotation) * translate(-origin * size) * scale(size)
+	// in one go, origin is a fraction of the size
+	static Affine2 trs(glm::vec2 position, GLfloat rotation, glm::vec2 size, glm::vec2 origin = glm::vec2(0.0f))
+	{
+		const GLfloat s = std::sin(rotation);
+		const GLfloat co = std::cos(rotation);
+		const glm::vec2 pivot = -origin * size;
+		return { co * size.x, s * size.x, -s * size.y, co * size.y,
+		         position.x + co * pivot.x - s * pivot.y, position.y + s * pivot.x + co * pivot.y };
+	}
+
+	glm::vec2 apply(glm::vec2 p) const
+	{
+		return { a * p.x + c * p.y + tx, b * p.x + d * p.y + ty };
+	}
+
+	// Box around the transformed corners of bounds
+	Bounds apply(const Bounds& bounds) const
+	{
+		const glm::vec2 center = apply((bounds.min + bounds.max) * 0.5f);
+		const glm::vec2 half = (bounds.max - bounds.min) * 0.5f;
+		const glm::vec2 extent(std::fabs(a) * half.x + std::fabs(c) * half.y, std::fabs(b) * half.x + std::fabs(d) * half.y);
+		return { center - extent, center + extent };
+	}
+
+	// this after rhs
+	Affine2 operator*(const Affine2& rhs) const
+	{
+		return { a * rhs.a + c * rhs.b, b * rhs.a + d * rhs.b,
+		         a * rhs.c + c * rhs.d, b * rhs.c + d * rhs.d,
+		         a * rhs.tx + c * rhs.ty + tx, b * rhs.tx + d * rhs.ty + ty };
+	}
+
+	Affine2 inverse() const
+	{
+		const GLfloat inv_det = 1.0f / (a * d - b * c);
+		const GLfloat ia = d * inv_det, ib = -b * inv_det, ic = -c * inv_det, id = a * inv_det;
+		return { ia, ib, ic, id, -(ia * tx + ic * ty), -(ib * tx + id * ty) };
+	}
+
+	glm::mat4 to_mat4() const
+	{
+		glm::mat4 m(1.0f);
+		m[0][0] = a;  m[0][1] = b;
+		m[1][0] = c;  m[1][1] = d;
+		m[3][0] = tx; m[3][1] = ty;
+		return m;
+	}
+};
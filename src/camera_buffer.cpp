@@ -0,0 +1,39 @@
+#include "camera_buffer.h"
+#include "Camera.h"
+#include "gl_state.h"
+
+#include <cstring>
+
+static_assert(sizeof(CameraBlock) == 144, "CameraBlock must match the std140 Camera block");
+
+CameraBuffer::CameraBuffer()
+	: ubo_(0), block_(), uploaded_(false)
+{
+	glGenBuffers(1, &ubo_);
+	GLState::bind_buffer(GL_UNIFORM_BUFFER, ubo_);
+	GLState::buffer_data(GL_UNIFORM_BUFFER, sizeof(CameraBlock), nullptr, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, binding, ubo_);
+}
+
+CameraBuffer::~CameraBuffer()
+{
+	glDeleteBuffers(1, &ubo_);
+}
+
+void CameraBuffer::update(const Camera& camera, glm::vec2 screen_resolution)
+{
+	CameraBlock block;
+	block.view = camera.transform_view();
+	block.projection = camera.get_orthographic_projection();
+	block.screen_resolution = screen_resolution;
+	block.padding = glm::vec2(0.0f);
+
+	// A still camera costs nothing
+	if (uploaded_ && std::memcmp(&block, &block_, sizeof(CameraBlock)) == 0)
+		return;
+
+	block_ = block;
+	uploaded_ = true;
+	GLState::bind_buffer(GL_UNIFORM_BUFFER, ubo_);
+	GLState::buffer_sub_data(GL_UNIFORM_BUFFER, 0, sizeof(CameraBlock), &block_);
+}
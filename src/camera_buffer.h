@@ -0,0 +1,42 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+struct Camera;
+
+// Per frame camera state, laid out like the std140 block every shader declares:
+//   layout (std140) uniform Camera { mat4 u_view; mat4 u_projection; vec2 u_screenResolution; };
+struct CameraBlock
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec2 screen_resolution;
+	glm::vec2 padding;
+};
+
+// One uniform buffer for the Camera block, filled once per frame and bound at a fixed
+// binding point. Shader links point their Camera block there, so no program needs its
+// own view or projection uploads.
+class CameraBuffer
+{
+public:
+	static constexpr GLuint binding = 0;
+	static constexpr const GLchar* block_name = "Camera";
+
+	CameraBuffer();
+	~CameraBuffer();
+
+	CameraBuffer(const CameraBuffer&) = delete;
+	CameraBuffer& operator=(const CameraBuffer&) = delete;
+
+	// Uploads only when something changed since the last update
+	void update(const Camera& camera, glm::vec2 screen_resolution);
+
+	const CameraBlock& block() const { return block_; }
+
+private:
+	GLuint ubo_;
+	CameraBlock block_;
+	bool uploaded_;
+};
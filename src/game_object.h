@@ -1,28 +1,25 @@
 #pragma once
 
 #include "rect.h"
-#include "renderer.h"
-
-struct Transform
-{
-    glm::vec2 position = { 0,0 };
-    float rotation = 0.0f;
-    float scale = 1.0f;
-};
+#include "EntityStore.h"
 
+// Handle to an entity in the Engine's EntityStore, kept so code written against
+// Engine::add_game_object() keeps working. Components live in the store's dense
+// arrays and move around, so fetch them on every use instead of keeping references.
 struct GameObject
 {
-    Transform transform;
-    Drawable drawable;
+    GameObject(EntityStore& store, Entity entity)
+        : entity(entity), store_(&store)
+    {}
 
-    virtual void start() {}
-    virtual void update(GLfloat dt)
-    {
-            drawable.position = transform.position;
-            drawable.rotation = transform.rotation;
-    }
-    virtual void draw(SpriteRenderer& renderer, const glm::mat4& view)
-    {
-            renderer.draw(drawable, view);
-    }
-};
\ No newline at end of file
+    Entity entity;
+
+    bool alive() const { return store_->alive(entity); }
+    TransformRef transform() { return store_->transform(entity); }
+    Transform world_transform() const { return store_->world_transform(entity); }
+    bool set_parent(const GameObject& parent) { return store_->set_parent(entity, parent.entity); }
+    Drawable& drawable() { return store_->drawable(entity); }
+
+private:
+    EntityStore* store_;
+};
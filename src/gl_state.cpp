@@ -0,0 +1,136 @@
+#include "gl_state.h"
+
+GLuint GLState::program_ = 0;
+GLuint GLState::active_unit_ = 0;
+GLuint GLState::textures_[GLState::max_units] = { 0 };
+bool GLState::valid_ = false;
+
+GLStateStats GLState::frame_;
+GLStateStats GLState::last_frame_;
+
+void GLState::use_program(GLuint program)
+{
+	if (valid_ && program_ == program)
+	{
+		++frame_.program_binds_elided;
+		return;
+	}
+
+	glUseProgram(program);
+	program_ = program;
+	valid_ = true;
+	++frame_.program_binds;
+}
+
+void GLState::active_texture(GLenum unit)
+{
+	const GLuint index = unit - GL_TEXTURE0;
+	if (valid_ && active_unit_ == index)
+		return;
+
+	glActiveTexture(unit);
+	active_unit_ = index;
+}
+
+void GLState::bind_texture(GLuint texture)
+{
+	if (active_unit_ < max_units && valid_ && textures_[active_unit_] == texture)
+	{
+		++frame_.texture_binds_elided;
+		return;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, texture);
+	if (active_unit_ < max_units)
+		textures_[active_unit_] = texture;
+	++frame_.texture_binds;
+}
+
+void GLState::enable(GLenum capability)
+{
+	glEnable(capability);
+	++frame_.state_changes;
+}
+
+void GLState::blend_func(GLenum source, GLenum destination)
+{
+	glBlendFunc(source, destination);
+	++frame_.state_changes;
+}
+
+void GLState::depth_func(GLenum function)
+{
+	glDepthFunc(function);
+	++frame_.state_changes;
+}
+
+void GLState::bind_vertex_array(GLuint vao)
+{
+	glBindVertexArray(vao);
+	++frame_.state_changes;
+}
+
+void GLState::bind_buffer(GLenum target, GLuint buffer)
+{
+	glBindBuffer(target, buffer);
+	++frame_.state_changes;
+}
+
+void GLState::vertex_attrib_pointer(GLuint index, GLint size, GLsizei stride, GLsizeiptr offset)
+{
+	glVertexAttribPointer(index, size, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(offset));
+	++frame_.state_changes;
+}
+
+void GLState::buffer_data(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+	glBufferData(target, size, data, usage);
+	++frame_.buffer_uploads;
+	if (data)
+		frame_.buffer_bytes += size;
+}
+
+void GLState::buffer_sub_data(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+{
+	glBufferSubData(target, offset, size, data);
+	++frame_.buffer_uploads;
+	frame_.buffer_bytes += size;
+}
+
+void GLState::draw_arrays(GLenum mode, GLint first, GLsizei count)
+{
+	glDrawArrays(mode, first, count);
+	++frame_.draw_calls;
+	++frame_.instances;
+}
+
+void GLState::draw_arrays_instanced(GLenum mode, GLint first, GLsizei count, GLsizei instances)
+{
+	glDrawArraysInstanced(mode, first, count, instances);
+	++frame_.draw_calls;
+	frame_.instances += instances;
+}
+
+void GLState::forget_program(GLuint program)
+{
+	if (program_ == program)
+		valid_ = false;
+}
+
+void GLState::forget_texture(GLuint texture)
+{
+	for (auto& bound : textures_)
+		if (bound == texture)
+			bound = 0;
+}
+
+void GLState::invalidate()
+{
+	valid_ = false;
+}
+
+void GLState::end_frame()
+{
+	last_frame_ = frame_;
+	frame_ = {};
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Calls issued to the driver and calls skipped because the state was already set
+struct GLStateStats
+{
+	GLuint draw_calls = 0;
+	GLuint instances = 0;
+	// Capability, blend, depth, vertex array, buffer and attribute changes
+	GLuint state_changes = 0;
+	GLuint buffer_uploads = 0;
+	GLsizeiptr buffer_bytes = 0;
+	// Drawables submitted and drawables skipped by camera culling
+	GLuint sprites_visible = 0;
+	GLuint sprites_culled = 0;
+
+	GLuint program_binds = 0;
+	GLuint program_binds_elided = 0;
+	GLuint texture_binds = 0;
+	GLuint texture_binds_elided = 0;
+	GLuint uniform_uploads = 0;
+	GLuint uniform_uploads_elided = 0;
+};
+
+// Shadow copy of the GL bindings we touch, so unchanged binds never reach the driver.
+// Everything that binds programs or textures should go through here to keep it in sync.
+class GLState
+{
+public:
+	static void use_program(GLuint program);
+	static void active_texture(GLenum unit);
+	static void bind_texture(GLuint texture);
+
+	// Counted pass-throughs, these are not cached
+	static void enable(GLenum capability);
+	static void blend_func(GLenum source, GLenum destination);
+	static void depth_func(GLenum function);
+	static void bind_vertex_array(GLuint vao);
+	static void bind_buffer(GLenum target, GLuint buffer);
+	static void vertex_attrib_pointer(GLuint index, GLint size, GLsizei stride, GLsizeiptr offset);
+	static void buffer_data(GLenum target, GLsizeiptr size, const void* data, GLenum usage);
+	static void buffer_sub_data(GLenum target, GLintptr offset, GLsizeiptr size, const void* data);
+	static void draw_arrays(GLenum mode, GLint first, GLsizei count);
+	static void draw_arrays_instanced(GLenum mode, GLint first, GLsizei count, GLsizei instances);
+
+	// Deleted objects may get their id reused, drop them from the cache
+	static void forget_program(GLuint program);
+	static void forget_texture(GLuint texture);
+
+	// Forget everything, for code that changed bindings behind our back
+	static void invalidate();
+
+	static GLStateStats& counters() { return frame_; }
+
+	// Closes the frame, last_frame() then returns its counters
+	static void end_frame();
+	static const GLStateStats& last_frame() { return last_frame_; }
+
+private:
+	static constexpr GLuint max_units = 16;
+
+	static GLuint program_;
+	static GLuint active_unit_;
+	static GLuint textures_[max_units];
+	static bool valid_;
+
+	static GLStateStats frame_;
+	static GLStateStats last_frame_;
+};
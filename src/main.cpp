@@ -1,12 +1,104 @@
 #include "Game.h"
+#include "AssetCooker.h"
+#include "Benchmark.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
 
 const GLuint SCR_WIDTH  = 1080;
 const GLuint SCR_HEIGHT = 1080;
 
-int main()
+int main(int argc, char* argv[])
 {
-    Prototype awesome(SCR_WIDTH, SCR_HEIGHT);
+    // TinyEngine --bench <name> [count]
+    if (argc > 2 && std::string(argv[1]) == "--bench")
+        return Benchmark::run(argv[2], argc > 3 ? std::stoul(argv[3]) : 0);
+
+    // TinyEngine --cook [pack], writes res/assets.pack by default
+    if (argc > 1 && std::string(argv[1]) == "--cook")
+        return AssetCooker::run(argc > 2 ? argv[2] : AssetCooker::default_pack);
+
+    // Engine options: --instanced, --threads <n>, --deterministic,
+    // --tick-rate <hz>, --headless [--ticks <n>] [--script <file>],
+    // --gl-stats <file.csv> dumps GL counters and GPU pass times every frame,
+    // --profile <trace.json> shows frame stats in the title and writes a Chrome trace on exit,
+    // --pack <file> loads assets from another pack, --no-pack loads the loose files in res,
+    // --no-shader-cache always compiles shaders from source, --watch-shaders reloads them on save,
+    // --crowd <n> adds n walkers pacing on their own behind the player, --flat walks on a flat floor,
+    // --record <file> writes every tick's input there on exit, --record-state adds the walkers' state,
+    // --replay <file> plays a recording back and checks the state against it, run it with the same
+    // game options it was recorded with
+    std::string trace_file;
+    std::size_t crowd_size = 0;
+    bool flat_ground = false;
+    EngineConfig config;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--instanced")
+            config.instanced_rendering = true;
+        else if (arg == "--threads" && i + 1 < argc)
+            config.thread_count = std::stoul(argv[++i]);
+        else if (arg == "--deterministic")
+            config.deterministic_jobs = true;
+        else if (arg == "--headless")
+            config.headless = true;
+        else if (arg == "--ticks" && i + 1 < argc)
+            config.headless_ticks = std::stoull(argv[++i]);
+        else if (arg == "--tick-rate" && i + 1 < argc)
+            config.tick_rate = std::stof(argv[++i]);
+        else if (arg == "--gl-stats" && i + 1 < argc)
+            config.gl_stats_csv = argv[++i];
+        else if (arg == "--pack" && i + 1 < argc)
+            config.asset_pack = argv[++i];
+        else if (arg == "--no-pack")
+            config.asset_pack.clear();
+        else if (arg == "--no-shader-cache")
+            config.shader_cache.clear();
+        else if (arg == "--watch-shaders")
+            config.watch_shaders = true;
+        else if (arg == "--crowd" && i + 1 < argc)
+            crowd_size = std::stoul(argv[++i]);
+        else if (arg == "--flat")
+            flat_ground = true;
+        else if (arg == "--record" && i + 1 < argc)
+            config.record_file = argv[++i];
+        else if (arg == "--record-state")
+            config.record_state = true;
+        else if (arg == "--replay" && i + 1 < argc)
+            config.replay_file = argv[++i];
+        else if (arg == "--profile" && i + 1 < argc)
+            trace_file = argv[++i];
+        else if (arg == "--script" && i + 1 < argc)
+        {
+            if (!config.input_script.load(argv[++i]))
+                return 1;
+        }
+    }
+
+    Profiler::set_enabled(!trace_file.empty());
+
+    Prototype awesome(SCR_WIDTH, SCR_HEIGHT, config);
+    awesome.crowd_size = crowd_size;
+    awesome.flat_ground = flat_ground;
     awesome.start();
+
+    auto start = std::chrono::steady_clock::now();
     awesome.run();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (config.headless)
+        std::cout << "headless: " << awesome.engine->tick << " ticks in " << elapsed.count() << " s, "
+            << awesome.engine->tick / elapsed.count() << " ticks/s" << std::endl;
+
+    if (!trace_file.empty())
+    {
+        FrameStats stats = Profiler::frame_stats();
+        std::cout << "frame ms over the last " << stats.frames << " frames: min " << stats.min << " avg " << stats.avg
+            << " p99 " << stats.p99 << " max " << stats.max << std::endl;
+        if (!Profiler::write_chrome_trace(trace_file))
+            return 1;
+    }
     return 0;
 }
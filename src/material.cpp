@@ -12,6 +12,6 @@ void Material::compile()
 
 void Material::bind()
 {
-	glActiveTexture(GL_TEXTURE0 + tex_unit_);
+	GLState::active_texture(GL_TEXTURE0 + tex_unit_);
 	texture->bind();
 }
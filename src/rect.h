@@ -3,6 +3,7 @@
 #include <iostream>
 #include <glad/glad.h>
 #include "glm/gtc/matrix_transform.hpp"
+#include "affine.h"
 #include "Camera.h"
 #include "material.h"
 #include "math.h"
@@ -20,39 +21,35 @@ struct Drawable
     glm::vec2 position = glm::vec2(0.0f);
     GLfloat rotation = 0.0f;
     glm::vec2 size = glm::vec2(64.0f);
+    // Part of the material's texture shown, (u0, v0, u1, v1). Atlas regions set this.
+    glm::vec4 uv_rect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
 
     Material* material;
 
-    glm::mat4 mat4_translated(glm::mat4 matrix) const
+    // transform_origin as a fraction of the size
+    glm::vec2 origin_fraction() const
     {
-        glm::vec2 normal_offset = glm::vec2(0.0f);
-
         switch (transform_origin)
         {
-        case centered:
-            normal_offset.x = 0.5f;
-            normal_offset.y = 0.5f;
-            break;
         case center_left:
-            normal_offset.y = 0.5f;
-            break;
+            return { 0.0f, 0.5f };
         case bottom_middle:
-            normal_offset.x = 0.5f;
-            normal_offset.y = 1.0f;
-            break;
+            return { 0.5f, 1.0f };
+        case centered:
+        default:
+            return { 0.5f, 0.5f };
         }
-        return glm::translate(matrix, glm::vec3(-normal_offset * size, 0.0f));
     }
 
-    glm::mat4 get_model_transform() const
+    // Maps the unit quad to world space
+    Affine2 get_affine() const
     {
-        glm::mat4 model = glm::mat4(1);
-        model = glm::translate(model, glm::vec3(position, 0.0f));
-        model = glm::rotate(model, rotation, glm::vec3(0.0f, 0.0f, 1.0f));
-        model = mat4_translated(model);
-    	model = glm::scale(model, glm::vec3(size, 1.0f));
+        return Affine2::trs(position, rotation, size, origin_fraction());
+    }
 
-        return model;
+    glm::mat4 get_model_transform() const
+    {
+        return get_affine().to_mat4();
     }
 };
 
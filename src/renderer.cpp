@@ -1,8 +1,33 @@
 #include "renderer.h"
+#include <cmath>
 #include <GL/gl.h>
 
 #include "Mouse.h"
+#include "Profiler.h"
 
+namespace
+{
+	// Same unit quad as SpriteRenderer, position doubles as texture coord
+	const GLfloat quad_corners[] = {
+		0.0f, 1.0f,
+		1.0f, 0.0f,
+		0.0f, 0.0f,
+
+		0.0f, 1.0f,
+		1.0f, 1.0f,
+		1.0f, 0.0f
+	};
+
+	void configure_gl_state()
+	{
+		GLState::enable(GL_CULL_FACE);
+		GLState::enable(GL_BLEND);
+		GLState::blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+		GLState::enable(GL_DEPTH_TEST);
+		GLState::depth_func(GL_ALWAYS);
+	}
+}
 
 SpriteRenderer::SpriteRenderer()
 	: vao_(0)
@@ -31,13 +56,7 @@ SpriteRenderer::SpriteRenderer()
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
 
-	glEnable(GL_CULL_FACE);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-	glEnable(GL_DEPTH_TEST);
-	glDepthFunc(GL_ALWAYS);
-
+	configure_gl_state();
 }
 
 SpriteRenderer::~SpriteRenderer()
@@ -46,8 +65,8 @@ SpriteRenderer::~SpriteRenderer()
 }
 
 // const
-// const material&, const glm::mat4& model, const glm::mat4& view
-void SpriteRenderer::draw(const Drawable& drawable, const glm::mat4& view)
+// const material&, const glm::mat4& model, view and projection come from the Camera block
+void SpriteRenderer::draw(const Drawable& drawable)
 {
 	Material* material = drawable.material;
 	Shader* shader = material->shader;
@@ -55,7 +74,6 @@ void SpriteRenderer::draw(const Drawable& drawable, const glm::mat4& view)
 	shader->use();
 	shader->set_vec3f("u_color", material->color);
 	shader->set_mat4("u_model", drawable.get_model_transform());
-	shader->set_mat4("u_view", view);
 	shader->set_vec2f("u_resolution", drawable.size);
 	material->bind();
 
@@ -64,8 +82,10 @@ void SpriteRenderer::draw(const Drawable& drawable, const glm::mat4& view)
 	glBindVertexArray(0);
 }
 
+const std::vector<GLuint> Renderer::sprite_attributes = { 2, 2, 3, 2, 2 };
+
 Renderer::Renderer(std::vector<GLuint> attributes, GLuint max_sprites)
-	: vbo_(0), vao_(0), current_material_(nullptr), max_sprites_(max_sprites)
+	: vbo_(0), vao_(0), runs_(0), max_sprites_(max_sprites), queued_floats_(0), view_(), draw_calls_(0), frame_draw_calls_(0)
 {
 	attrib_size_ = 0;
     for (auto att : attributes) attrib_size_ += att;
@@ -76,8 +96,9 @@ Renderer::Renderer(std::vector<GLuint> attributes, GLuint max_sprites)
 
     glBindVertexArray(vao_);
 
-    // set up vbo data inside gpu
+    // set up vbo data inside gpu, refilled every flush
     glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * max_sprites_ * 6 * attrib_size_, nullptr, GL_STREAM_DRAW);
 
     auto stride = 0ull;
     for (auto i = 0ull; i < attributes.size(); ++i)
@@ -87,6 +108,11 @@ Renderer::Renderer(std::vector<GLuint> attributes, GLuint max_sprites)
         glEnableVertexAttribArray(i);
         stride += sizeof(GLfloat) * attributes[i];
     }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    configure_gl_state();
 }
 
 Renderer::~Renderer()
@@ -94,118 +120,251 @@ Renderer::~Renderer()
 	if (vbo_)
         glDeleteBuffers(1, &vbo_);
     if (vao_)
-        glDeleteBuffers(1, &vao_);
+        glDeleteVertexArrays(1, &vao_);
 
     vbo_ = 0;
     vao_ = 0;
 }
 
-void Renderer::begin()
+void Renderer::begin(const Affine2& view)
 {
-	current_material_ = nullptr;
+	view_ = view;
+	frame_draw_calls_ = 0;
 }
 
 void Renderer::end()
 {
 	flush();
+	draw_calls_ = frame_draw_calls_;
 }
 
-void Renderer::draw(Drawable& drawable_struct)
+void Renderer::draw(const Drawable& drawable_struct)
 {
-	/*
-	rect dest_rect = { drawable_struct.position.x, drawable_struct.position.y , drawable_struct.size.x, drawable_struct.size.y };
-	// handle texture rect some other way?
-	rect src_rect = { 0,0, drawable_struct.size.x, drawable_struct.size.y };
-	auto& material = drawable_struct.material;
+	const size_t sprite_floats = 6 * attrib_size_;
+	if (queued_floats_ + sprite_floats > max_sprites_ * sprite_floats)
+		flush();
+
+	Material* material = drawable_struct.material;
 
-	if ((this->buffer_.size() >= this->max_sprites_ * 6 * this->attrib_size_ || !current_material_) ||
-		this->current_material_->id != material.id)
+	// Extend the last run when it has the same shader/texture pair, materials only differ by
+	// color which goes per vertex. Anything else starts a new run so draw order holds.
+	if (runs_ == 0 || batches_[runs_ - 1].shader != material->shader || batches_[runs_ - 1].texture != material->texture)
 	{
-		this->flush();
-		this->current_material_ = &material;
+		if (runs_ == batches_.size())
+			batches_.push_back({});
+		Batch& run = batches_[runs_++];
+		run.shader = material->shader;
+		run.texture = material->texture;
+		run.material = material;
 	}
 
-	// translate to fractions of the image dimensions
-	auto norm_src = src_rect;
-	auto img_w = material.texture.width;
-	auto img_h = material.texture.height;
-
-	norm_src.x /= img_w;
-	norm_src.y /= img_h;
-	norm_src.w /= img_w;
-	norm_src.h /= img_h;
-
-	// first triangle
-
-	// bot left
-	buffer_.push_back(dest_rect.x);
-	buffer_.push_back(dest_rect.y + dest_rect.h);
-	// texture
-	buffer_.push_back(norm_src.x);
-	buffer_.push_back(norm_src.y + norm_src.h);
-
-	// top right
-	buffer_.push_back(dest_rect.x + dest_rect.w);
-	buffer_.push_back(dest_rect.y);
-	// texture
-	buffer_.push_back(norm_src.x + norm_src.w);
-	buffer_.push_back(norm_src.y);
-
-	// top left
-	buffer_.push_back(dest_rect.x);
-	buffer_.push_back(dest_rect.y);
-	// texture
-	buffer_.push_back(norm_src.x);
-	buffer_.push_back(norm_src.y);
-
-	// second triangle
-
-	// bot left
-	buffer_.push_back(dest_rect.x);
-	buffer_.push_back(dest_rect.y + dest_rect.h);
-	// texture
-	buffer_.push_back(norm_src.x);
-	buffer_.push_back(norm_src.y + norm_src.h);
-
-	// bot right
-	buffer_.push_back(dest_rect.x + dest_rect.w);
-	buffer_.push_back(dest_rect.y + dest_rect.h);
-	// texture
-	buffer_.push_back(norm_src.x + norm_src.w);
-	buffer_.push_back(norm_src.y + norm_src.h);
-
-	// top right
-	buffer_.push_back(dest_rect.x + dest_rect.w);
-	buffer_.push_back(dest_rect.y);
-	// texture
-	buffer_.push_back(norm_src.x + norm_src.w);
-	buffer_.push_back(norm_src.y);
-
-
-	material.shader.set_vec2f("u_resolution", drawable_struct.size);
-	//material.shader.set_mat4("u_model", drawable_struct.get_model_transform());
-	*/
+	Batch& batch = batches_[runs_ - 1];
+
+	const Affine2 model_view = view_ * drawable_struct.get_affine();
+	const glm::vec3& color = material->color;
+	const glm::vec2& size = drawable_struct.size;
+	const glm::vec4& uv = drawable_struct.uv_rect;
+
+	for (size_t corner = 0; corner < 6; ++corner)
+	{
+		const GLfloat u = quad_corners[corner * 2];
+		const GLfloat v = quad_corners[corner * 2 + 1];
+		const glm::vec2 position = model_view.apply({ u, v });
+		const glm::vec2 tex_coords = glm::mix(glm::vec2(uv.x, uv.y), glm::vec2(uv.z, uv.w), glm::vec2(u, v));
+
+		batch.vertices.insert(batch.vertices.end(), { position.x, position.y, tex_coords.x, tex_coords.y, color.r, color.g, color.b, size.x, size.y, u, v });
+	}
+	queued_floats_ += sprite_floats;
 }
 
 void Renderer::flush()
 {
-	if (this->buffer_.empty()) 
+	if (runs_ == 0)
 		return;
 
-	if(!this->current_material_)
+	PROFILE_ZONE("Renderer::flush");
+
+	GLState::bind_vertex_array(vao_);
+	GLState::bind_buffer(GL_ARRAY_BUFFER, vbo_);
+
+	// Orphan last flush's storage so the driver doesn't stall on draws still reading it
+	GLState::buffer_data(GL_ARRAY_BUFFER, sizeof(GLfloat) * max_sprites_ * 6 * attrib_size_, nullptr, GL_STREAM_DRAW);
+
+	GLsizeiptr offset = 0;
+	for (size_t index = 0; index < runs_; ++index)
+	{
+		auto& vertices = batches_[index].vertices;
+		GLState::buffer_sub_data(GL_ARRAY_BUFFER, offset * sizeof(GLfloat), sizeof(GLfloat) * vertices.size(), vertices.data());
+		offset += vertices.size();
+	}
+
+	GLint first = 0;
+	for (size_t index = 0; index < runs_; ++index)
+	{
+		Batch& batch = batches_[index];
+		const GLsizei count = static_cast<GLsizei>(batch.vertices.size() / attrib_size_);
+
+		batch.material->compile();
+		batch.material->bind();
+
+		GLState::draw_arrays(GL_TRIANGLES, first, count);
+		++frame_draw_calls_;
+
+		first += count;
+		batch.vertices.clear();
+	}
+
+	runs_ = 0;
+	queued_floats_ = 0;
+
+	GLState::bind_buffer(GL_ARRAY_BUFFER, 0);
+	GLState::bind_vertex_array(0);
+}
+
+InstancedRenderer::InstancedRenderer(GLuint max_instances)
+	: quad_vbo_(0), instance_vbo_(0), vao_(0), runs_(0), max_instances_(max_instances), queued_instances_(0), view_(),
+	  draw_calls_(0), frame_draw_calls_(0)
+{
+	glGenVertexArrays(1, &vao_);
+	glGenBuffers(1, &quad_vbo_);
+	glGenBuffers(1, &instance_vbo_);
+
+	glBindVertexArray(vao_);
+
+	// Static unit quad, position doubles as texture coord
+	glBindBuffer(GL_ARRAY_BUFFER, quad_vbo_);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(quad_corners), quad_corners, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), (void*)nullptr);
+
+	// Per instance stream, pointers are set per batch in flush
+	glBindBuffer(GL_ARRAY_BUFFER, instance_vbo_);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * instance_floats * max_instances_, nullptr, GL_STREAM_DRAW);
+	for (GLuint attribute = 1; attribute <= 5; ++attribute)
 	{
-		this->buffer_.clear();
+		glEnableVertexAttribArray(attribute);
+		glVertexAttribDivisor(attribute, 1);
+	}
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	configure_gl_state();
+}
+
+InstancedRenderer::~InstancedRenderer()
+{
+	if (quad_vbo_)
+		glDeleteBuffers(1, &quad_vbo_);
+	if (instance_vbo_)
+		glDeleteBuffers(1, &instance_vbo_);
+	if (vao_)
+		glDeleteVertexArrays(1, &vao_);
+}
+
+void InstancedRenderer::begin(const Affine2& view)
+{
+	view_ = view;
+	frame_draw_calls_ = 0;
+}
+
+void InstancedRenderer::end()
+{
+	flush();
+	draw_calls_ = frame_draw_calls_;
+}
+
+void InstancedRenderer::draw(const Drawable& drawable_struct)
+{
+	if (queued_instances_ == max_instances_)
+		flush();
+
+	Material* material = drawable_struct.material;
+
+	// Same run rule as Renderer::draw
+	if (runs_ == 0 || batches_[runs_ - 1].shader != material->shader || batches_[runs_ - 1].texture != material->texture)
+	{
+		if (runs_ == batches_.size())
+			batches_.push_back({});
+		Batch& run = batches_[runs_++];
+		run.shader = material->shader;
+		run.texture = material->texture;
+		run.material = material;
+	}
+
+	Batch& batch = batches_[runs_ - 1];
+
+	// Origin and size are folded into the affine, size rides along for the fragment shaders
+	const Affine2 m = view_ * drawable_struct.get_affine();
+	const glm::vec2& size = drawable_struct.size;
+	const glm::vec3& color = material->color;
+	const glm::vec4& uv = drawable_struct.uv_rect;
+
+	batch.instances.insert(batch.instances.end(), {
+		m.a, m.c, m.tx,
+		m.b, m.d, m.ty,
+		size.x, size.y,
+		color.r, color.g, color.b,
+		uv.x, uv.y, uv.z, uv.w });
+	++queued_instances_;
+}
+
+void InstancedRenderer::set_instance_offset(size_t first_instance)
+{
+	const GLsizei stride = instance_floats * sizeof(GLfloat);
+	const size_t base = first_instance * stride;
+	const GLuint sizes[] = { 3, 3, 2, 3, 4 };
+
+	size_t offset = 0;
+	for (GLuint i = 0; i < 5; ++i)
+	{
+		GLState::vertex_attrib_pointer(i + 1, sizes[i], stride, base + offset);
+		offset += sizes[i] * sizeof(GLfloat);
+	}
+}
+
+void InstancedRenderer::flush()
+{
+	if (runs_ == 0)
 		return;
+
+	PROFILE_ZONE("InstancedRenderer::flush");
+
+	GLState::bind_vertex_array(vao_);
+	GLState::bind_buffer(GL_ARRAY_BUFFER, instance_vbo_);
+
+	// Orphan, then upload every batch back to back
+	GLState::buffer_data(GL_ARRAY_BUFFER, sizeof(GLfloat) * instance_floats * max_instances_, nullptr, GL_STREAM_DRAW);
+
+	GLsizeiptr offset = 0;
+	for (size_t index = 0; index < runs_; ++index)
+	{
+		auto& instances = batches_[index].instances;
+		GLState::buffer_sub_data(GL_ARRAY_BUFFER, offset * sizeof(GLfloat), sizeof(GLfloat) * instances.size(), instances.data());
+		offset += instances.size();
 	}
 
-	this->current_material_->compile();
-	this->current_material_->bind();
+	size_t first = 0;
+	for (size_t index = 0; index < runs_; ++index)
+	{
+		Batch& batch = batches_[index];
+		const GLsizei count = static_cast<GLsizei>(batch.instances.size() / instance_floats);
+
+		batch.material->compile();
+		batch.material->bind();
 
-    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * this->buffer_.size(), this->buffer_.data(), GL_STATIC_DRAW);
+		// No base instance in GL 3.3, point the instance attributes at this batch instead
+		set_instance_offset(first);
+		GLState::draw_arrays_instanced(GL_TRIANGLES, 0, 6, count);
+		++frame_draw_calls_;
+
+		first += count;
+		batch.instances.clear();
+	}
 
-	// draw triangle
-	glDrawArrays(GL_TRIANGLES, 0, this->buffer_.size() / attrib_size_);
+	runs_ = 0;
+	queued_instances_ = 0;
 
-	// clear buffer for next cycle
-	buffer_.clear();
+	GLState::bind_buffer(GL_ARRAY_BUFFER, 0);
+	GLState::bind_vertex_array(0);
 }
@@ -14,22 +14,87 @@ public:
 	SpriteRenderer();
 	~SpriteRenderer();
 
-	void draw(const Drawable& drawable_struct, const glm::mat4& view);
+	void draw(const Drawable& drawable_struct);
 };
 
+// Streaming sprite batcher. Drawables are transformed on the CPU and consecutive draws with
+// the same shader/texture pair share one vertex run, so a frame costs one draw call per
+// material change instead of per object. Runs are drawn in submission order, so later
+// draws stay on top.
 class Renderer
 {
+	struct Batch
+	{
+		Shader* shader;
+		Texture* texture;
+		Material* material;
+		std::vector<GLfloat> vertices;
+	};
+
 	GLuint vbo_, vao_, attrib_size_;
-	std::vector<GLfloat> buffer_;
-	Material* current_material_;
+	// batches_[0, runs_) are queued, the rest keep their storage for later flushes
+	std::vector<Batch> batches_;
+	size_t runs_;
 	GLuint max_sprites_;
+	size_t queued_floats_;
+	Affine2 view_;
+	GLuint draw_calls_, frame_draw_calls_;
 
 public:
+	// Vertex layout: view space position, texture coord, color, drawable size, quad corner.
+	// Texture coords are the corner mapped into Drawable::uv_rect, the corner stays for shape shaders.
+	// The view is composed into each sprite's transform on the CPU, shaders only project.
+	static const std::vector<GLuint> sprite_attributes;
+
 	Renderer(std::vector<GLuint> attributes, GLuint max_sprites);
 	~Renderer();
 
-	void begin();
+	void begin(const Affine2& view);
 	void end();
-	void draw(Drawable& drawable_struct);
+	void draw(const Drawable& drawable_struct);
 	void flush();
+
+	// Draw calls issued by the last begin/end pair
+	GLuint draw_calls() const { return draw_calls_; }
+};
+
+// Instanced sprite path. One static unit quad, every Drawable becomes a per instance record
+// (view * model affine rows, size, color, uv rect) and each run of draws with the same
+// shader/texture pair is a single glDrawArraysInstanced, in submission order like Renderer.
+// Needs the sprite_instanced.vs vertex shader.
+class InstancedRenderer
+{
+	struct Batch
+	{
+		Shader* shader;
+		Texture* texture;
+		Material* material;
+		std::vector<GLfloat> instances;
+	};
+
+	GLuint quad_vbo_, instance_vbo_, vao_;
+	// batches_[0, runs_) are queued, the rest keep their storage for later flushes
+	std::vector<Batch> batches_;
+	size_t runs_;
+	GLuint max_instances_;
+	size_t queued_instances_;
+	Affine2 view_;
+	GLuint draw_calls_, frame_draw_calls_;
+
+	void set_instance_offset(size_t first_instance);
+
+public:
+	// affine row 0, affine row 1, size, color, uv rect
+	static constexpr GLuint instance_floats = 3 + 3 + 2 + 3 + 4;
+
+	InstancedRenderer(GLuint max_instances);
+	~InstancedRenderer();
+
+	void begin(const Affine2& view);
+	void end();
+	void draw(const Drawable& drawable_struct);
+	void flush();
+
+	// Draw calls issued by the last begin/end pair
+	GLuint draw_calls() const { return draw_calls_; }
 };
@@ -1,10 +1,37 @@
 #include "shader.h"
+#include "camera_buffer.h"
+#include "ShaderCache.h"
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+    // FNV-1a, uniform lookups compare hashes before names
+    std::uint32_t hash_name(const GLchar* name)
+    {
+        std::uint32_t hash = 2166136261u;
+        for (; *name; ++name)
+            hash = (hash ^ static_cast<unsigned char>(*name)) * 16777619u;
+        return hash;
+    }
+
+    bool read_file(const std::string& file_name, std::string& text)
+    {
+        std::ifstream file(file_name);
+        if (!file)
+            return false;
+        std::stringstream stream;
+        stream << file.rdbuf();
+        text = stream.str();
+        return true;
+    }
+}
 
 
-void Shader::compile(const GLchar* vs_data, const GLchar* fs_data)
+GLuint Shader::compile(const GLchar* vs_data, const GLchar* fs_data)
 {
     // compile debug flags
     GLint success;
@@ -23,8 +50,9 @@ void Shader::compile(const GLchar* vs_data, const GLchar* fs_data)
     if (!success)
     {
         glGetShaderInfoLog(vs, 512, nullptr, info_log);
-        std::cerr << "Vertex shader failed to compile: vs = " << vs_file_name_ << std::endl;
-        throw;
+        std::cerr << "Vertex shader failed to compile: vs = " << vs_file_name_ << "\n" << info_log << std::endl;
+        glDeleteShader(vs);
+        return 0;
     }
 
     // fragment shader
@@ -37,70 +65,167 @@ void Shader::compile(const GLchar* vs_data, const GLchar* fs_data)
     if (!success)
     {
         glGetShaderInfoLog(fs, 512, nullptr, info_log);
-        std::cerr << "Fragment shader failed to compile: fs = " << fs_file_name_ << std::endl;
+        std::cerr << "Fragment shader failed to compile: fs = " << fs_file_name_ << "\n" << info_log << std::endl;
+        glDeleteShader(vs);
+        glDeleteShader(fs);
+        return 0;
     }
 
     // shader program init
-    id_ = glCreateProgram();
-    glAttachShader(id_, vs);
-    glAttachShader(id_, fs);
-    glLinkProgram(id_);
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+    ShaderCache::mark_retrievable(program);
+    glLinkProgram(program);
+
+    // delete orphaned shader files
+    glDeleteShader(vs);
+    glDeleteShader(fs);
 
     // linking errors
-    glGetProgramiv(id_, GL_LINK_STATUS, &success);
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
     if (!success)
     {
-        glGetProgramInfoLog(id_, 512, nullptr, info_log);
-        std::cerr << "Shader program linking failure: vs = " << vs_file_name_ << "fs = " << fs_file_name_ << std::endl;
-        throw;
+        glGetProgramInfoLog(program, 512, nullptr, info_log);
+        std::cerr << "Shader program linking failure: vs = " << vs_file_name_ << " fs = " << fs_file_name_ << "\n" << info_log << std::endl;
+        glDeleteProgram(program);
+        return 0;
     }
 
-    // delete orphaned shader files
-    glDeleteShader(vs);
-    glDeleteShader(fs);
+    return program;
+}
 
+bool Shader::link_program(const GLchar* vs_data, const GLchar* fs_data)
+{
+    // a cached binary skips compile and link, binaries come back without block bindings
+    const std::uint64_t cache_key = ShaderCache::key(vs_data, fs_data);
+    GLuint program = ShaderCache::load(cache_key);
+    if (program)
+    {
+        std::cout << "Shader cache hit: " << vs_file_name_ << " + " << fs_file_name_ << std::endl;
+    }
+    else
+    {
+        program = compile(vs_data, fs_data);
+        if (!program)
+            return false;
+        ShaderCache::store(cache_key, program);
+        if (ShaderCache::enabled())
+            std::cout << "Shader cache miss: " << vs_file_name_ << " + " << fs_file_name_ << std::endl;
+    }
+
+    // swap in, materials only hold the Shader so they all pick up the new program
+    if (id_)
+    {
+        GLState::forget_program(id_);
+        glDeleteProgram(id_);
+    }
+    id_ = program;
+
+    reflect_uniforms();
+
+    // shared per frame blocks, GLSL 330 can't name the binding itself
+    GLuint camera_block = glGetUniformBlockIndex(id_, CameraBuffer::block_name);
+    if (camera_block != GL_INVALID_INDEX)
+        glUniformBlockBinding(id_, camera_block, CameraBuffer::binding);
+    return true;
 }
 
-void Shader::load(const GLchar* vs_file_name, const GLchar* fs_file_name)
+void Shader::reflect_uniforms()
 {
-    vs_file_name_ = vs_file_name;
-    fs_file_name_ = fs_file_name;
+    uniforms_.clear();
+
+    GLint count = 0, max_length = 0;
+    glGetProgramiv(id_, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(id_, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
 
+    std::vector<GLchar> name(max_length + 1);
+    for (GLint i = 0; i < count; ++i)
+    {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(id_, i, static_cast<GLsizei>(name.size()), &length, &size, &type, name.data());
+
+        // arrays are reported as "name[0]", we look them up by "name"
+        std::string uniform_name(name.data(), length);
+        auto bracket = uniform_name.find('[');
+        if (bracket != std::string::npos)
+            uniform_name.resize(bracket);
+
+        Uniform uniform;
+        uniform.hash = hash_name(uniform_name.c_str());
+        uniform.name = uniform_name;
+        uniform.location = glGetUniformLocation(id_, uniform_name.c_str());
+        if (uniform.location >= 0)
+            uniforms_.push_back(uniform);
+    }
+}
+
+Shader::Uniform* Shader::find_uniform(const GLchar* name)
+{
+    const std::uint32_t hash = hash_name(name);
+    for (auto& uniform : uniforms_)
+        if (uniform.hash == hash && uniform.name == name)
+            return &uniform;
+    return nullptr;
+}
+
+bool Shader::changed(Uniform& uniform, const void* data, GLsizei size)
+{
+    GLStateStats& stats = GLState::counters();
+    if (uniform.value_size == size && std::memcmp(uniform.value, data, size) == 0)
+    {
+        ++stats.uniform_uploads_elided;
+        return false;
+    }
+
+    std::memcpy(uniform.value, data, size);
+    uniform.value_size = size;
+    ++stats.uniform_uploads;
+    return true;
+}
+
+void Shader::load(const GLchar* vs_file_name, const GLchar* fs_file_name)
+{
     // load shaders from file
     std::string vs_code;
     std::string fs_code;
-
-    try
+    if (!read_file(vs_file_name, vs_code) || !read_file(fs_file_name, fs_code))
     {
-        // open files
-        std::ifstream vs_file(vs_file_name);
-        std::ifstream fs_file(fs_file_name);
-        std::stringstream vs_stream, fs_stream;
-
-        // read into temp string streams
-        vs_stream << vs_file.rdbuf();
-        fs_stream << fs_file.rdbuf();
-
-        // close file streams
-        vs_file.close();
-        fs_file.close();
-
-        // convert streams into strings
-        vs_code = vs_stream.str();
-        fs_code = fs_stream.str();
+        std::cerr << "Failed to read shader files!" << std::endl;
+        throw std::runtime_error(std::string("Failed to read shader files: ") + vs_file_name + ", " + fs_file_name);
     }
-    catch (std::exception e)
+
+    load_source(vs_file_name, vs_code.c_str(), fs_file_name, fs_code.c_str());
+}
+
+void Shader::load_source(const GLchar* vs_file_name, const GLchar* vs_code, const GLchar* fs_file_name, const GLchar* fs_code)
+{
+    vs_file_name_ = vs_file_name;
+    fs_file_name_ = fs_file_name;
+
+    if (!link_program(vs_code, fs_code))
+        throw std::runtime_error(std::string("Failed to build shader: ") + vs_file_name + ", " + fs_file_name);
+}
+
+bool Shader::reload()
+{
+    std::string vs_code;
+    std::string fs_code;
+    if (!read_file(vs_file_name_, vs_code) || !read_file(fs_file_name_, fs_code))
     {
-        std::cerr << "Failed to read shader files!" << std::endl;
-        throw;
+        std::cerr << "Failed to read shader files: vs = " << vs_file_name_ << " fs = " << fs_file_name_ << std::endl;
+        return false;
     }
 
-    compile(vs_code.c_str(), fs_code.c_str());
+    // the old program stays in use when the new sources don't build
+    return link_program(vs_code.c_str(), fs_code.c_str());
 }
 
 void Shader::use()
 {
-    glUseProgram(id_);
+    GLState::use_program(id_);
 }
 
 GLint Shader::get_attrib_location(const GLchar* attrib_name)
@@ -108,62 +233,84 @@ GLint Shader::get_attrib_location(const GLchar* attrib_name)
     return glGetAttribLocation(id_, attrib_name);
 }
 
+GLint Shader::get_uniform_location(const GLchar* uniform_name)
+{
+    Uniform* uniform = find_uniform(uniform_name);
+    return uniform ? uniform->location : -1;
+}
+
 void Shader::set_bool(const GLchar* name, GLboolean value)
 {
-    glUniform1i(glGetUniformLocation(id_, name), value);
+    set_int(name, value);
 }
 
 void Shader::set_int(const GLchar* name, GLint value)
 {
-    glUniform1i(glGetUniformLocation(id_, name), value);
+    Uniform* uniform = find_uniform(name);
+    if (uniform && changed(*uniform, &value, sizeof(value)))
+        glUniform1i(uniform->location, value);
 }
 
 void  Shader::set_float(const GLchar* name, GLfloat value)
 {
-    glUniform1f(glGetUniformLocation(id_, name), value);
+    Uniform* uniform = find_uniform(name);
+    if (uniform && changed(*uniform, &value, sizeof(value)))
+        glUniform1f(uniform->location, value);
 }
 
 void Shader::set_vec2f(const GLchar* name, const glm::vec2& value)
 {
-    glUniform2fv(glGetUniformLocation(id_, name), 1, &value[0]);
+    Uniform* uniform = find_uniform(name);
+    if (uniform && changed(*uniform, &value[0], sizeof(value)))
+        glUniform2fv(uniform->location, 1, &value[0]);
 }
 
 void Shader::set_vec2f(const GLchar* name, GLfloat x, GLfloat y)
 {
-    glUniform2f(glGetUniformLocation(id_, name), x, y);
+    set_vec2f(name, glm::vec2(x, y));
 }
 
 void Shader::set_vec3f(const GLchar* name, const glm::vec3& value)
 {
-    glUniform3fv(glGetUniformLocation(id_, name), 1, &value[0]);
+    Uniform* uniform = find_uniform(name);
+    if (uniform && changed(*uniform, &value[0], sizeof(value)))
+        glUniform3fv(uniform->location, 1, &value[0]);
 }
 
 void Shader::set_vec3f(const GLchar* name, GLfloat x, GLfloat y, GLfloat z)
 {
-    glUniform3f(glGetUniformLocation(id_, name), x, y, z);
+    set_vec3f(name, glm::vec3(x, y, z));
 }
 
 void Shader::set_vec4f(const GLchar* name, const glm::vec4& value)
 {
-    glUniform4fv(glGetUniformLocation(id_, name), 1, &value[0]);
+    Uniform* uniform = find_uniform(name);
+    if (uniform && changed(*uniform, &value[0], sizeof(value)))
+        glUniform4fv(uniform->location, 1, &value[0]);
 }
 
 void Shader::set_vec4f(const GLchar* name, GLfloat x, GLfloat y, GLfloat z, GLfloat w)
 {
-    glUniform4f(glGetUniformLocation(id_, name), x, y, z, w);
+    set_vec4f(name, glm::vec4(x, y, z, w));
 }
 
 void Shader::set_mat2(const GLchar* name, const glm::mat2& matrix)
 {
-    glUniformMatrix2fv(glGetUniformLocation(id_, name), 1, GL_FALSE, &matrix[0][0]);
+    Uniform* uniform = find_uniform(name);
+    if (uniform && changed(*uniform, &matrix[0][0], sizeof(matrix)))
+        glUniformMatrix2fv(uniform->location, 1, GL_FALSE, &matrix[0][0]);
 }
 
 void Shader::set_mat3(const GLchar* name, const glm::mat3& matrix)
 {
-    glUniformMatrix3fv(glGetUniformLocation(id_, name), 1, GL_FALSE, &matrix[0][0]);
+    Uniform* uniform = find_uniform(name);
+    if (uniform && changed(*uniform, &matrix[0][0], sizeof(matrix)))
+        glUniformMatrix3fv(uniform->location, 1, GL_FALSE, &matrix[0][0]);
 }
 
 void Shader::set_mat4(const GLchar* name, const glm::mat4& matrix)
 {
-    glUniformMatrix4fv(glGetUniformLocation(id_, name), 1, GL_FALSE, &matrix[0][0]);
+    Uniform* uniform = find_uniform(name);
+    if (uniform && changed(*uniform, &matrix[0][0], sizeof(matrix)))
+        glUniformMatrix4fv(uniform->location, 1, GL_FALSE, &matrix[0][0]);
 }
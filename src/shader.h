@@ -1,17 +1,40 @@
 #pragma once
 
 #include <glad/glad.h>
+#include <cstdint>
 #include <string>
+#include <vector>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 #include <glm/vec4.hpp>
 #include <glm/matrix.hpp>
 
+#include "gl_state.h"
+
 class Shader
 {
 	std::string vs_file_name_, fs_file_name_;
 
-	void compile(const GLchar* vs_data, const GLchar* fs_data);
+	// Active uniform reflected at link time, with the last value uploaded to it
+	struct Uniform
+	{
+		std::uint32_t hash;
+		std::string name;
+		GLint location;
+		GLuint value[16];
+		GLsizei value_size = 0;
+	};
+	std::vector<Uniform> uniforms_;
+
+	// compile builds from source, link_program goes through ShaderCache first and swaps the
+	// result in. Both report errors and leave id_ alone when the sources don't build.
+	GLuint compile(const GLchar* vs_data, const GLchar* fs_data);
+	bool link_program(const GLchar* vs_data, const GLchar* fs_data);
+	void reflect_uniforms();
+	Uniform* find_uniform(const GLchar* name);
+
+	// Records the value and returns false when the uniform already holds it
+	bool changed(Uniform& uniform, const void* data, GLsizei size);
 
 public:
 	GLuint id_;
@@ -21,15 +44,25 @@ public:
 	~Shader()
 	{
 		if (id_)
+		{
+			GLState::forget_program(id_);
 			glDeleteProgram(id_);
+		}
 		id_ = 0;
 	}
 	void load(const GLchar* vs_file_name, const GLchar* fs_file_name);
+	// Sources already in memory, the names are only used in error messages and by reload()
+	void load_source(const GLchar* vs_file_name, const GLchar* vs_code, const GLchar* fs_file_name, const GLchar* fs_code);
+	// Rebuilds from the files, keeps the current program and returns false if they don't build
+	bool reload();
+	const std::string& vs_file_name() const { return vs_file_name_; }
+	const std::string& fs_file_name() const { return fs_file_name_; }
 	void use();
 
 	GLint get_attrib_location(const GLchar* attrib_name);
+	GLint get_uniform_location(const GLchar* uniform_name);
 
-	// uniform sets
+	// uniform sets, uniforms the program does not use and unchanged values are skipped
 	void set_bool(const GLchar* name, GLboolean value);
 	void set_int(const GLchar* name, GLint value);
 	void set_float(const GLchar* name, GLfloat value);
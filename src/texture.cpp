@@ -1,4 +1,5 @@
 #include "texture.h"
+#include "gl_state.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -26,7 +27,13 @@ Texture::Texture()
 
 Texture::~Texture()
 {
+	GLState::forget_texture(id_);
 	glDeleteTextures(1, &id_);
+	if (upload_id_)
+	{
+		GLState::forget_texture(upload_id_);
+		glDeleteTextures(1, &upload_id_);
+	}
 }
 
 void Texture::load(const GLchar* tex_file_name)
@@ -42,11 +49,24 @@ void Texture::load(const GLchar* tex_file_name)
 		throw;
 	}
 
-	// Set dimensions
-	this->width = width;
-	this->height = height;
+	allocate(width, height);
+	upload_rows(0, height, image);
+	finish_upload();
 
-	glBindTexture(GL_TEXTURE_2D, this->id_);
+	// Free image data
+	stbi_image_free(image);
+}
+
+void Texture::allocate(GLuint width, GLuint height, GLuint levels)
+{
+	// Materials may be sampling this texture, so the new image gets storage of its own
+	if (!upload_id_)
+		glGenTextures(1, &upload_id_);
+	upload_width_ = width;
+	upload_height_ = height;
+	levels_ = levels;
+
+	GLState::bind_texture(upload_id_);
 
 	// Create texture parameters
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, this->wrap_s);
@@ -54,20 +74,54 @@ void Texture::load(const GLchar* tex_file_name)
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, this->filter_min);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, this->filter_mag);
 
-	// Create Texture
-	glTexImage2D(GL_TEXTURE_2D, 0, this->internal_format, this->width, this->height, 0, this->image_format,
-	             GL_UNSIGNED_BYTE, image);
-	glGenerateMipmap(GL_TEXTURE_2D);
+	// Create Texture, contents follow through upload_rows
+	for (GLuint level = 0; level < levels; ++level)
+		glTexImage2D(GL_TEXTURE_2D, level, this->internal_format, level_size(width, level),
+		             level_size(height, level), 0, this->image_format, GL_UNSIGNED_BYTE, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels > 1 ? levels - 1 : 1000);
+}
+
+void Texture::upload_rows(GLuint y, GLuint rows, const void* pixels, GLuint level)
+{
+	GLState::bind_texture(upload_id_);
+	glTexSubImage2D(GL_TEXTURE_2D, level, 0, y, level_size(upload_width_, level), rows, this->image_format,
+	                GL_UNSIGNED_BYTE, pixels);
+}
+
+void Texture::finish_upload()
+{
+	GLState::bind_texture(upload_id_);
+	// Cooked textures arrive with their whole chain
+	if (levels_ == 1)
+		glGenerateMipmap(GL_TEXTURE_2D);
 
 	// Unbind texture
-	glBindTexture(GL_TEXTURE_2D, 0);
+	GLState::bind_texture(0);
+	swap_in_upload();
+	loaded_ = true;
+}
 
-	// Free image data
-	stbi_image_free(image);
+void Texture::load_placeholder(const unsigned char rgba[4])
+{
+	allocate(1, 1);
+	upload_rows(0, 1, rgba);
+	GLState::bind_texture(0);
+	swap_in_upload();
+	loaded_ = false;
+}
+
+void Texture::swap_in_upload()
+{
+	GLState::forget_texture(id_);
+	glDeleteTextures(1, &id_);
+	id_ = upload_id_;
+	upload_id_ = 0;
+	width = upload_width_;
+	height = upload_height_;
 }
 
 void Texture::bind()
 {
-	// activate tex slot then bind the texture to active tex slot
-	glBindTexture(GL_TEXTURE_2D, id_);
+	// bind the texture to the active tex slot, skipped if it is already there
+	GLState::bind_texture(id_);
 }
@@ -24,6 +24,33 @@ public:
 	Texture();
 	~Texture();
 
+	// Decodes and uploads in one blocking call
 	void load(const GLchar* tex_file_name);
 	void bind();
+
+	// Piecewise upload for streaming. allocate() sizes the first levels mip levels and applies
+	// the parameters, upload_rows() fills rows [y, y + rows) of a level from RGBA8 pixels, or
+	// from an offset into the bound GL_PIXEL_UNPACK_BUFFER, and finish_upload() builds the
+	// mipmaps unless every level was uploaded. The rows go into separate storage, bind() and
+	// width/height keep the previous image until finish_upload() swaps the new one in.
+	void allocate(GLuint width, GLuint height, GLuint levels = 1);
+	void upload_rows(GLuint y, GLuint rows, const void* pixels, GLuint level = 0);
+	void finish_upload();
+
+	// Dimension of a mip level
+	static GLuint level_size(GLuint size, GLuint level) { return size >> level ? size >> level : 1; }
+
+	// 1x1 texture of one color, shown while the real image streams in
+	void load_placeholder(const unsigned char rgba[4]);
+	bool loaded() const { return loaded_; }
+
+private:
+	// Makes the storage allocate() started the one bind() uses
+	void swap_in_upload();
+
+	GLuint levels_ = 1;
+	bool loaded_ = false;
+	// Storage being uploaded, 0 when no upload is in progress
+	GLuint upload_id_ = 0;
+	GLuint upload_width_ = 0, upload_height_ = 0;
 };
\ No newline at end of file